@@ -0,0 +1,100 @@
+#pragma once
+#include "registers.hpp"
+#include "system.hpp"
+
+// erase / program of the internal flash with the FLASH_* overlay the stock
+// firmware leaves in SRAM. Addresses are the ones mods are linked at, the
+// controller counts words from the start of the chip, below the app window
+// sits the 4K bootloader. Erased flash reads 0xFF, programming only clears
+// bits until the sector is erased again
+//
+// Erase and program follow the stock bootloader: IRQs off, wait idle,
+// mode, ADDR = chip offset >> 2, WDATA, unlock, start, wait, read mode,
+// lock. Not yet run on a radio, so they are left out of mod builds until
+// one is built with FLASH_WRITE_ENABLED 1; reads work either way
+#ifndef FLASH_WRITE_ENABLED
+#ifdef UV_K5_SIM
+#define FLASH_WRITE_ENABLED 1
+#else
+#define FLASH_WRITE_ENABLED 0
+#endif
+#endif
+
+// the flash can't be fetched from while it erases or programs, so the
+// code waiting on it is copied to SRAM with .data
+#ifndef UV_K5_SIM
+#define FLASH_RAM_CODE __attribute__((section(".ramsection"), noinline, long_call))
+#else
+#define FLASH_RAM_CODE
+#endif
+
+namespace Flash
+{
+   static constexpr unsigned short SectorSize = 512;
+   static constexpr unsigned int BootloaderSize = 0x1000;
+   static constexpr unsigned int AppSize = 0xF000;
+   static constexpr unsigned int Erased = 0xFFFFFFFF;
+
+   // CFG bits 2..4, the stock FLASH_ReadByAPB sets 5
+   enum eMode : unsigned int
+   {
+      ReadAhb = 0,
+      Program = 1,
+      Erase = 2,
+      ReadApb = 5,
+   };
+
+   // calls only into the overlay, which sits in SRAM as well. Erase takes
+   // a few ms, a word some 10s of us
+   FLASH_RAM_CODE inline void StartAndWait()
+   {
+      FLASH_Unlock();
+      FLASH_Start();
+      while (FLASH_IsBusy())
+         ;
+
+      FLASH_SetMode(ReadAhb);
+      FLASH_Lock();
+   }
+
+   inline void Run(eMode Mode, unsigned int u32Address, unsigned int u32Data)
+   {
+      if (!FLASH_WRITE_ENABLED || u32Address >= AppSize)
+      {
+         return;
+      }
+
+#ifndef UV_K5_SIM
+      __asm volatile("cpsid i" ::: "memory");
+#endif
+      while (FLASH_IsBusy())
+         ;
+
+      FLASH_SetMode(Mode);
+      FLASH->ADDR = (BootloaderSize + u32Address) >> 2;
+      if (Mode == Program)
+      {
+         FLASH->WDATA = u32Data;
+      }
+
+      StartAndWait();
+#ifndef UV_K5_SIM
+      __asm volatile("cpsie i" ::: "memory");
+#endif
+   }
+
+   inline void EraseSector(unsigned int u32Address)
+   {
+      Run(Erase, u32Address & ~(SectorSize - 1), 0);
+   }
+
+   inline void ProgramWord(unsigned int u32Address, unsigned int u32Data)
+   {
+      Run(Program, u32Address, u32Data);
+   }
+
+   inline unsigned int ReadWord(unsigned int u32Address)
+   {
+      return FLASH_ReadByAHB(u32Address);
+   }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "registers.hpp"
+
+namespace SysTick
+{
+   // stock fw runs the core at 48MHz with a 10ms SysTick
+   static constexpr unsigned int CyclesPerUs = 48;
+
+   // core cycles elapsed since the current tick started, counter runs down
+   inline unsigned int GetTickCycles()
+   {
+      return SYSTICK->LOAD - SYSTICK->VAL;
+   }
+
+   inline unsigned int GetPeriodCycles()
+   {
+      return SYSTICK->LOAD + 1;
+   }
+};
@@ -5,6 +5,7 @@ struct TFlash
    unsigned int CFG;
    unsigned int ADDR;
    unsigned int WDATA;
+   unsigned int RDATA;
    unsigned int START;
    unsigned int ST;
    unsigned int LOCK;
@@ -15,7 +16,6 @@ struct TFlash
 };
 
 #define FLASH_BASE 0x4006F000
-#define FLASH ((TFlash*)FLASH_BASAE)
 
 struct TPort
 {
@@ -27,7 +27,7 @@ struct TPort
    unsigned int PORTC_SEL1;
    unsigned int PORTA_IE;
    unsigned int PORTB_IE;
-   unsigned int PORTC_IE;
+   volatile unsigned int PORTC_IE;
    unsigned int PORTA_PU;
    unsigned int PORTB_PU;
    unsigned int PORTC_PU;
@@ -45,8 +45,8 @@ struct TPort
 
 struct TGpio
 {
-   unsigned int DATA;
-   unsigned int DIR;
+   volatile unsigned int DATA;
+   volatile unsigned int DIR;
 };
 
 struct TSysCon
@@ -78,19 +78,63 @@ struct TAdc
    unsigned int ADC_CALIB_KD;
 };
 
+struct TSpi
+{
+   unsigned int CR;
+   volatile unsigned int WDR;
+   volatile unsigned int RDR;
+   unsigned int RESERVED;
+   unsigned int IE;
+   volatile unsigned int IF;
+   volatile unsigned int FIFOST;
+};
+
+#define SPI_CR_MSR_SSN (1 << 9)
+#define SPI_FIFOST_TFE (1 << 3)
+#define SPI_FIFOST_TFF (1 << 4)
+
+struct TSysTick
+{
+   unsigned int CTRL;
+   unsigned int LOAD;
+   volatile unsigned int VAL;
+   unsigned int CALIB;
+};
+
+#ifdef UV_K5_SIM
+// host simulation build (see sim/), peripherals are plain objects
+namespace Sim
+{
+   extern TPort Port;
+   extern TGpio GpioA;
+   extern TGpio GpioB;
+   extern TGpio GpioC;
+   extern TSysCon SysCon;
+   extern TAdc Adc;
+   extern TSpi Spi0;
+   extern TSysTick SysTickTimer;
+   extern TFlash FlashCtrl;
+}
+#endif
+
 #define GPIO_BASE 0x400B0000
-#define GPIO ((TPort*)GPIO_BASE)
 #define __BKPT(value)                       __asm volatile ("bkpt "#value)
 
-
 #define GPIOA_BASE 0x40060000
-#define GPIOA ((TGpio*)GPIOA_BASE)
-
 #define GPIOB_BASE 0x40060800
-#define GPIOB ((TGpio*)GPIOB_BASE)
-
 #define GPIOC_BASE 0x40061000
+
+#ifndef UV_K5_SIM
+#define GPIO ((TPort*)GPIO_BASE)
+#define GPIOA ((TGpio*)GPIOA_BASE)
+#define GPIOB ((TGpio*)GPIOB_BASE)
 #define GPIOC ((TGpio*)GPIOC_BASE)
+#else
+#define GPIO (&Sim::Port)
+#define GPIOA (&Sim::GpioA)
+#define GPIOB (&Sim::GpioB)
+#define GPIOC (&Sim::GpioC)
+#endif
 
 #define GPIO_PIN_0  (1 << 0 )
 #define GPIO_PIN_1  (1 << 1 )
@@ -110,9 +154,23 @@ struct TAdc
 #define GPIO_PIN_15 (1 << 15)
 
 #define SYSCON_BASE 0x40000000
-#define SYSCON ((TSysCon*)SYSCON_BASE)
-
 #define ADC_BASE 0x400BA000
+#define SPI0_BASE 0x400B8000
+
+#define SYSTICK_BASE 0xE000E010
+
+#ifndef UV_K5_SIM
+#define SYSCON ((TSysCon*)SYSCON_BASE)
 #define ADC ((TAdc*)ADC_BASE)
+#define SPI0 ((TSpi*)SPI0_BASE)
+#define SYSTICK ((TSysTick*)SYSTICK_BASE)
+#define FLASH ((TFlash*)FLASH_BASE)
+#else
+#define SYSCON (&Sim::SysCon)
+#define ADC (&Sim::Adc)
+#define SPI0 (&Sim::Spi0)
+#define SYSTICK (&Sim::SysTickTimer)
+#define FLASH (&Sim::FlashCtrl)
+#endif
 
 
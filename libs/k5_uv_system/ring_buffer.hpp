@@ -0,0 +1,55 @@
+#pragma once
+
+// single producer / single consumer byte queue between an interrupt
+// handler and the code it interrupts. Each side writes only its own
+// index and byte stores are atomic on the M0, so no locking is needed.
+// Indexes run free and are masked on access, Size is a power of 2
+template <unsigned char Size>
+class CRingBuffer
+{
+   static_assert(Size && Size <= 128 && !(Size & (Size - 1)),
+                 "Size has to be a power of 2 up to 128");
+
+public:
+   // producer side, false when full
+   bool Push(unsigned char u8Data)
+   {
+      unsigned char const u8Head = this->u8Head;
+      if ((unsigned char)(u8Head - u8Tail) == Size)
+      {
+         return false;
+      }
+
+      U8Data[u8Head & (Size - 1)] = u8Data;
+      Barrier(); // data before the index that publishes it
+      this->u8Head = u8Head + 1;
+      return true;
+   }
+
+   // consumer side, false when empty
+   bool Pop(unsigned char &u8Data)
+   {
+      unsigned char const u8Tail = this->u8Tail;
+      if (u8Tail == u8Head)
+      {
+         return false;
+      }
+
+      u8Data = U8Data[u8Tail & (Size - 1)];
+      Barrier(); // data read before the slot is handed back
+      this->u8Tail = u8Tail + 1;
+      return true;
+   }
+
+   bool IsEmpty() const { return u8Tail == u8Head; }
+
+   // only while the producer is stopped
+   void Clear() { u8Tail = u8Head; }
+
+private:
+   static void Barrier() { __asm volatile("" ::: "memory"); }
+
+   unsigned char U8Data[Size];
+   volatile unsigned char u8Head = 0;
+   volatile unsigned char u8Tail = 0;
+};
@@ -6,6 +6,7 @@
 
 .extern Reset_Handler
 .extern SysTick_Handler
+.extern __org_vectors_start
 
   .section .isr_vectors,"a",%progbits
   .type VectorTable, %object
@@ -27,40 +28,118 @@ VectorTable:
   .word 13  //Reserved6
   .word 14  //IRQ_PendSV + 1
   .word SysTick_Handler + 1
-  .word 16
-  .word 17
-  .word 18
-  .word 19
-  .word 20
-  .word 21
-  .word 22
-  .word 23
-  .word 24
-  .word 25
-  .word 26
-  .word 27
-  .word 28
-  .word 29
-  .word 30
-  .word 31
-  .word 32
-  .word 33
-  .word 34
-  .word 35
-  .word 36
-  .word 37
-  .word 38
-  .word 39
-  .word 40
-  .word 41
-  .word 42
-  .word 43
-  .word 44
-  .word 45
-  .word 46
-  .word 47
+  .word Irq0_Handler + 1
+  .word Irq1_Handler + 1
+  .word Irq2_Handler + 1
+  .word Irq3_Handler + 1
+  .word Irq4_Handler + 1
+  .word Irq5_Handler + 1
+  .word Irq6_Handler + 1
+  .word Irq7_Handler + 1
+  .word Irq8_Handler + 1
+  .word Irq9_Handler + 1
+  .word Irq10_Handler + 1
+  .word Irq11_Handler + 1
+  .word Irq12_Handler + 1
+  .word Irq13_Handler + 1
+  .word Irq14_Handler + 1
+  .word Irq15_Handler + 1
+  .word Irq16_Handler + 1
+  .word Irq17_Handler + 1
+  .word Irq18_Handler + 1
+  .word Irq19_Handler + 1
+  .word Irq20_Handler + 1
+  .word Irq21_Handler + 1
+  .word Irq22_Handler + 1
+  .word Irq23_Handler + 1
+  .word Irq24_Handler + 1
+  .word Irq25_Handler + 1
+  .word Irq26_Handler + 1
+  .word Irq27_Handler + 1
+  .word Irq28_Handler + 1
+  .word Irq29_Handler + 1
+  .word Irq30_Handler + 1
+  .word Irq31_Handler + 1
 
   .size	VectorTable, .-VectorTable
 
 .global VectorTable
 
+// external interrupts, a mod takes one over by defining Irq<n>_Handler,
+// the rest go on to the handler in the stock fw vector table
+  .section .text.Default_Handler,"ax",%progbits
+  .weak Default_Handler
+  .type Default_Handler, %function
+  .thumb_func
+Default_Handler:
+  mrs r0, ipsr
+  lsls r0, r0, #2
+  ldr r1, =__org_vectors_start
+  ldr r0, [r1, r0]
+  bx r0
+  .size Default_Handler, .-Default_Handler
+
+  .weak Irq0_Handler
+  .thumb_set Irq0_Handler, Default_Handler
+  .weak Irq1_Handler
+  .thumb_set Irq1_Handler, Default_Handler
+  .weak Irq2_Handler
+  .thumb_set Irq2_Handler, Default_Handler
+  .weak Irq3_Handler
+  .thumb_set Irq3_Handler, Default_Handler
+  .weak Irq4_Handler
+  .thumb_set Irq4_Handler, Default_Handler
+  .weak Irq5_Handler
+  .thumb_set Irq5_Handler, Default_Handler
+  .weak Irq6_Handler
+  .thumb_set Irq6_Handler, Default_Handler
+  .weak Irq7_Handler
+  .thumb_set Irq7_Handler, Default_Handler
+  .weak Irq8_Handler
+  .thumb_set Irq8_Handler, Default_Handler
+  .weak Irq9_Handler
+  .thumb_set Irq9_Handler, Default_Handler
+  .weak Irq10_Handler
+  .thumb_set Irq10_Handler, Default_Handler
+  .weak Irq11_Handler
+  .thumb_set Irq11_Handler, Default_Handler
+  .weak Irq12_Handler
+  .thumb_set Irq12_Handler, Default_Handler
+  .weak Irq13_Handler
+  .thumb_set Irq13_Handler, Default_Handler
+  .weak Irq14_Handler
+  .thumb_set Irq14_Handler, Default_Handler
+  .weak Irq15_Handler
+  .thumb_set Irq15_Handler, Default_Handler
+  .weak Irq16_Handler
+  .thumb_set Irq16_Handler, Default_Handler
+  .weak Irq17_Handler
+  .thumb_set Irq17_Handler, Default_Handler
+  .weak Irq18_Handler
+  .thumb_set Irq18_Handler, Default_Handler
+  .weak Irq19_Handler
+  .thumb_set Irq19_Handler, Default_Handler
+  .weak Irq20_Handler
+  .thumb_set Irq20_Handler, Default_Handler
+  .weak Irq21_Handler
+  .thumb_set Irq21_Handler, Default_Handler
+  .weak Irq22_Handler
+  .thumb_set Irq22_Handler, Default_Handler
+  .weak Irq23_Handler
+  .thumb_set Irq23_Handler, Default_Handler
+  .weak Irq24_Handler
+  .thumb_set Irq24_Handler, Default_Handler
+  .weak Irq25_Handler
+  .thumb_set Irq25_Handler, Default_Handler
+  .weak Irq26_Handler
+  .thumb_set Irq26_Handler, Default_Handler
+  .weak Irq27_Handler
+  .thumb_set Irq27_Handler, Default_Handler
+  .weak Irq28_Handler
+  .thumb_set Irq28_Handler, Default_Handler
+  .weak Irq29_Handler
+  .thumb_set Irq29_Handler, Default_Handler
+  .weak Irq30_Handler
+  .thumb_set Irq30_Handler, Default_Handler
+  .weak Irq31_Handler
+  .thumb_set Irq31_Handler, Default_Handler
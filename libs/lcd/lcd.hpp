@@ -2,6 +2,7 @@
 #include <string.h>
 #include <type_traits>
 #include "system.hpp"
+#include "number_format.hpp"
 
 struct ILcd {
   virtual void UpdateScreen() = 0;
@@ -16,6 +17,9 @@ struct IBitmap {
   static constexpr auto SizeY = _SizeY;
   static constexpr auto LineHeight = _LineHeight;
   static constexpr auto Lines = _SizeX / _LineHeight;
+  // byte per column in 8 pixel pages, LSB on top (ST7565 layout). When set,
+  // CDisplay draws straight into pBuffStart instead of going pixel by pixel
+  static constexpr bool PagedLayout = false;
   static constexpr unsigned short GetCoursorPosition(unsigned char u8Line,
                                                      unsigned char u8XPos) {
     return (u8Line * SizeX) + u8XPos;
@@ -26,7 +30,10 @@ struct IBitmap {
   virtual void *GetCoursorData(unsigned short u16CoursorPosition) const {
     return nullptr;
   }
-  virtual void ClearAll() = 0;
+  virtual void ClearAll() const = 0;
+  // bitmaps flushed in parts hide this to track what was written through
+  // GetCoursorData
+  void MarkDirtyAt(unsigned short u16Position, unsigned short u16Len) const {}
   const unsigned char *pBuffStart;
 };
 
@@ -41,19 +48,32 @@ struct IFont {
 template <class BitmapType> class CDisplay {
 public:
   constexpr CDisplay(BitmapType &_Bitmap)
-      : Bitmap(_Bitmap), pCurrentFont(nullptr), u16CoursorPosition(0) {}
+      : Bitmap(_Bitmap), pCurrentFont(nullptr), u16CoursorPosition(0),
+        u8CoursorShift(0) {}
 
   void SetCoursor(unsigned char u8Line, unsigned char u8X) const {
     u16CoursorPosition = (u8Line * Bitmap.SizeX) + u8X;
+    u8CoursorShift = 0;
   }
 
+  // any y on paged bitmaps, glyphs then straddle two pages
   void SetCoursorXY(unsigned char x, unsigned char y) const {
-    u16CoursorPosition = x + (y << 4);
+    u16CoursorPosition = x + (y >> 3) * Bitmap.SizeX;
+    u8CoursorShift = y & 7;
   }
 
   void SetFont(const IFont *pFont) const { pCurrentFont = pFont; }
 
   void DrawLine(int sx, int ex, int ny) {
+    if constexpr (BitmapType::PagedLayout) {
+      if (ny < 0 || ny >= Bitmap.SizeY || ex < 0 || sx >= Bitmap.SizeX) {
+        return;
+      }
+
+      FillRow(sx < 0 ? 0 : sx, ex < Bitmap.SizeX ? ex : Bitmap.SizeX - 1, ny);
+      return;
+    }
+
     for (int i = sx; i <= ex; i++) {
       if (i < Bitmap.SizeX && ny < Bitmap.SizeY) {
         Bitmap.SetPixel(i, ny);
@@ -62,6 +82,16 @@ public:
   }
 
   void DrawHLine(int sy, int ey, int nx, bool bCropped = false) {
+    if constexpr (BitmapType::PagedLayout) {
+      if (nx < 0 || nx >= Bitmap.SizeX || ey < 0 || sy >= Bitmap.SizeY) {
+        return;
+      }
+
+      FillColumn(nx, sy < 0 ? 0 : sy, ey < Bitmap.SizeY ? ey : Bitmap.SizeY - 1,
+                 bCropped ? 0b10101010 : 0xFF);
+      return;
+    }
+
     for (int i = sy; i <= ey; i++) {
       if (i < Bitmap.SizeY && nx < Bitmap.SizeX && (!bCropped || i % 2)) {
         Bitmap.SetPixel(nx, i);
@@ -119,6 +149,24 @@ public:
     unsigned char maxY =
         (sy + height < Bitmap.SizeY) ? sy + height : Bitmap.SizeY;
 
+    if constexpr (BitmapType::PagedLayout) {
+      if (sx >= maxX || sy >= maxY) {
+        return;
+      }
+
+      if (bFilled) {
+        for (unsigned char x = sx; x < maxX; x++) {
+          FillColumn(x, sy, maxY - 1);
+        }
+      } else {
+        FillColumn(sx, sy, maxY - 1);
+        FillColumn(maxX - 1, sy, maxY - 1);
+        FillRow(sx, maxX - 1, sy);
+        FillRow(sx, maxX - 1, maxY - 1);
+      }
+      return;
+    }
+
     // Draw vertical lines
     for (unsigned char y = sy; y < maxY; y++) {
       Bitmap.SetPixel(sx, y);
@@ -141,23 +189,67 @@ public:
     }
   }
 
+  // paged bitmaps only, inclusive and already clipped ranges: a masked OR
+  // per page for columns, one OR run for rows. Only bytes that actually
+  // change are marked dirty
+  void FillColumn(unsigned char x, unsigned char sy, unsigned char ey,
+                  unsigned char u8Pattern = 0xFF) const {
+    if (sy > ey) {
+      return;
+    }
+
+    auto *const pColumn = (unsigned char *)Bitmap.pBuffStart + x;
+    const unsigned char u8FirstPage = sy >> 3;
+    const unsigned char u8LastPage = ey >> 3;
+    for (unsigned char u8Page = u8FirstPage; u8Page <= u8LastPage; u8Page++) {
+      unsigned char u8Mask = u8Pattern;
+      if (u8Page == u8FirstPage) {
+        u8Mask &= 0xFF << (sy & 7);
+      }
+      if (u8Page == u8LastPage) {
+        u8Mask &= 0xFF >> (7 - (ey & 7));
+      }
+
+      auto &u8Byte = pColumn[u8Page * Bitmap.SizeX];
+      if ((u8Byte | u8Mask) != u8Byte) {
+        u8Byte |= u8Mask;
+        Bitmap.MarkDirtyAt(u8Page * Bitmap.SizeX + x, 1);
+      }
+    }
+  }
+
+  void FillRow(unsigned char sx, unsigned char ex, unsigned char y) const {
+    if (sx > ex) {
+      return;
+    }
+
+    const unsigned short u16Start = (y >> 3) * Bitmap.SizeX + sx;
+    auto *pData = (unsigned char *)Bitmap.pBuffStart + u16Start;
+    const unsigned char u8Bit = 1 << (y & 7);
+    unsigned char u8Changed = 0, u8Begin = 0, u8End = 0;
+    for (unsigned char i = 0; i <= ex - sx; i++) {
+      if (!(pData[i] & u8Bit)) {
+        pData[i] |= u8Bit;
+        u8Begin = u8Changed++ ? u8Begin : i;
+        u8End = i + 1;
+      }
+    }
+
+    if (u8Changed) {
+      Bitmap.MarkDirtyAt(u16Start + u8Begin, u8End - u8Begin);
+    }
+  }
+
+  // GetSizeY is the glyph width (cursor advance), GetSizeX its height
   unsigned char PrintCharacter(const char c8Character) const {
     if (!pCurrentFont) {
       return 0;
     }
 
-    const auto *const pFontRawData = pCurrentFont->GetRaw(c8Character);
-    auto *pCoursorPosition = Bitmap.GetCoursorData(u16CoursorPosition);
-    auto const CopySize =
-        pCurrentFont->GetSizeY(c8Character) * (BitmapType::LineHeight / 8);
-    if (pCoursorPosition && !(BitmapType::LineHeight % 8)) {
-      if (pFontRawData)
-        memcpy(pCoursorPosition, pFontRawData, CopySize);
-      else
-        memset(pCoursorPosition, 0, CopySize);
-    }
-
-    u16CoursorPosition += pCurrentFont->GetSizeY(c8Character);
+    const auto u8Width = pCurrentFont->GetSizeY(c8Character);
+    BlitColumns(pCurrentFont->GetRaw(c8Character), u8Width,
+                pCurrentFont->GetSizeX(c8Character));
+    Advance(u8Width);
     return 0;
   }
 
@@ -188,7 +280,7 @@ public:
     return u8Digts * pCurrentFont->GetSizeX('0');
   }
 
-  static constexpr int powersOfTen[9] = {
+  static constexpr int powersOfTen[10] = {
       1,        // 10^0
       10,       // 10^1
       100,      // 10^2
@@ -197,9 +289,12 @@ public:
       100000,   // 10^5
       1000000,  // 10^6
       10000000, // 10^7
-      100000000 // 10^8
+      100000000, // 10^8
+      1000000000 // 10^9
   };
-  void PrintFixedDigitsNumber2(int s32Number, unsigned char u8DigsToCut = 2,
+  template <class TInt = int>
+  void PrintFixedDigitsNumber2(typename NumberFormat::TSame<TInt>::Type s32Number,
+                               unsigned char u8DigsToCut = 2,
                                unsigned char u8FixedDigtsCnt = 0) {
     char U8NumBuff[11] = {0}; // 9 digits, sign, and null terminator
     int startIdx = 0;
@@ -238,7 +333,9 @@ public:
 
     Print(U8NumBuff + startIdx);
   }
-  void PrintFixedDigitsNumber3(int s32Number, unsigned char u8DigsToCut = 2,
+  template <class TInt = int>
+  void PrintFixedDigitsNumber3(typename NumberFormat::TSame<TInt>::Type s32Number,
+                               unsigned char u8DigsToCut = 2,
                                unsigned char u8FixedDigtsCnt = 0,
                                unsigned char pointAt = 128) {
     char U8NumBuff[11] = {0}; // 9 digits, sign, and null terminator
@@ -262,19 +359,167 @@ public:
 
     const char *str = U8NumBuff + startIdx;
     const char len = Strlen(str);
-    const char dot[1] = {64};
     for (unsigned char i = 0; i < len; i++) {
       if (pointAt == len - i) {
-        auto *pCoursorPosition = Bitmap.GetCoursorData(u16CoursorPosition + 1);
-        memcpy(pCoursorPosition, dot, 1);
-        u16CoursorPosition += 2;
+        PrintDecimalPoint();
       }
       PrintCharacter(str[i]);
     }
   }
 
+  // PrintFixedDigitsNumber3 with the layout fixed at compile time: Digits
+  // digits of s32Number / 10^DigsToCut, zero padded, the point before the
+  // last PointAt of them. Negative numbers get a '-'. Fields below 10^4
+  // divide by ten with a multiply, wider ones take a digit in four
+  // compares against 8, 4, 2 and 1 times its power of ten
+  template <unsigned char DigsToCut, unsigned char Digits,
+            unsigned char PointAt = 0, class TInt = int>
+  void PrintFixed(typename NumberFormat::TSame<TInt>::Type s32Number) const {
+    static_assert(Digits && DigsToCut + Digits <= 9 && PointAt < Digits,
+                  "field doesn't fit an int");
+    if (s32Number < 0) {
+      PrintCharacter('-');
+      s32Number = -s32Number;
+    }
+
+    // digits above the field are dropped, one compare when the value fits.
+    // Narrow fields drop them on the way, they only need the multiply
+    constexpr bool bNarrow = DigsToCut + Digits <= 4;
+    if (s32Number >= (bNarrow ? NumberFormat::SmallLimit
+                              : powersOfTen[DigsToCut + Digits])) {
+      for (unsigned char i = 9; i >= DigsToCut + Digits; i--) {
+        while (s32Number >= powersOfTen[i]) {
+          s32Number -= powersOfTen[i];
+        }
+      }
+    }
+
+    char C8Digits[Digits];
+    if constexpr (bNarrow) {
+      for (unsigned char i = 0; i < DigsToCut; i++) {
+        s32Number = NumberFormat::DivSmall10<TInt>(s32Number);
+      }
+
+      for (unsigned char i = Digits; i--;) {
+        auto const s32Q = NumberFormat::DivSmall10<TInt>(s32Number);
+        C8Digits[i] = (char)('0' + (s32Number - s32Q * 10));
+        s32Number = s32Q;
+      }
+    } else {
+      for (unsigned char i = 0; i < Digits; i++) {
+        auto const s32Power = powersOfTen[DigsToCut + Digits - 1 - i];
+        C8Digits[i] = '0';
+        for (unsigned char u8Weight = 8; u8Weight; u8Weight >>= 1) {
+          if (s32Number >= u8Weight * s32Power) {
+            s32Number -= u8Weight * s32Power;
+            C8Digits[i] += u8Weight;
+          }
+        }
+      }
+    }
+
+    for (unsigned char i = 0; i < Digits; i++) {
+      if (PointAt && i == Digits - PointAt) {
+        PrintDecimalPoint();
+      }
+      PrintCharacter(C8Digits[i]);
+    }
+  }
+
 private:
+  static constexpr unsigned char PastRightEdge = 0x80;
+  static constexpr unsigned char DecimalPoint = 64;
+
+  void PrintDecimalPoint() const {
+    Advance(1);
+    BlitColumns(&DecimalPoint, 1, 8);
+    Advance(1);
+  }
+
+  // text running off the right edge is cut, not continued on the next page
+  void Advance(unsigned char u8Columns) const {
+    if (u16CoursorPosition % Bitmap.SizeX + u8Columns >= Bitmap.SizeX) {
+      u8CoursorShift |= PastRightEdge;
+    }
+
+    u16CoursorPosition += u8Columns;
+  }
+
+  // opaque blit of one page high columns at the cursor, nullptr clears.
+  // Paged bitmaps shift them by u8CoursorShift across two pages, clip at
+  // the right and bottom edge instead of wrapping to the next page and
+  // mark the glyph dirty only if it differs from what is already there
+  void BlitColumns(const unsigned char *pData, unsigned char u8Width,
+                   unsigned char u8Height) const {
+    if constexpr (BitmapType::PagedLayout) {
+      constexpr unsigned char Pages = BitmapType::SizeY >> 3;
+      const unsigned char u8X = u16CoursorPosition % Bitmap.SizeX;
+      const unsigned char u8Page = u16CoursorPosition / Bitmap.SizeX;
+      if (u8Page >= Pages || (u8CoursorShift & PastRightEdge)) {
+        return;
+      }
+
+      if (u8Width > Bitmap.SizeX - u8X) {
+        u8Width = Bitmap.SizeX - u8X;
+      }
+
+      auto *const pDst = (unsigned char *)Bitmap.pBuffStart + u16CoursorPosition;
+      const unsigned char u8Mask = u8Height < 8 ? (1 << u8Height) - 1 : 0xFF;
+      const unsigned char u8Shift = u8CoursorShift;
+      if (!u8Shift && u8Mask == 0xFF) {
+        bool bChanged = false;
+        for (unsigned char i = 0; i < u8Width; i++) {
+          const unsigned char u8Column = pData ? pData[i] : 0;
+          bChanged |= pDst[i] != u8Column;
+          pDst[i] = u8Column;
+        }
+
+        if (bChanged) {
+          Bitmap.MarkDirtyAt(u16CoursorPosition, u8Width);
+        }
+        return;
+      }
+
+      const unsigned char u8MaskLow = u8Mask << u8Shift;
+      const unsigned char u8MaskHigh = u8Shift ? u8Mask >> (8 - u8Shift) : 0;
+      const bool bNextPage = u8MaskHigh && u8Page + 1 < Pages;
+      auto *const pDstNext = pDst + Bitmap.SizeX;
+      bool bChanged = false, bNextChanged = false;
+      for (unsigned char i = 0; i < u8Width; i++) {
+        const unsigned char u8Column = pData ? pData[i] & u8Mask : 0;
+        const unsigned char u8Low =
+            (pDst[i] & ~u8MaskLow) | (unsigned char)(u8Column << u8Shift);
+        bChanged |= pDst[i] != u8Low;
+        pDst[i] = u8Low;
+        if (bNextPage) {
+          const unsigned char u8High =
+              (pDstNext[i] & ~u8MaskHigh) | (u8Column >> (8 - u8Shift));
+          bNextChanged |= pDstNext[i] != u8High;
+          pDstNext[i] = u8High;
+        }
+      }
+
+      if (bChanged) {
+        Bitmap.MarkDirtyAt(u16CoursorPosition, u8Width);
+      }
+      if (bNextChanged) {
+        Bitmap.MarkDirtyAt(u16CoursorPosition + Bitmap.SizeX, u8Width);
+      }
+    } else {
+      auto *pCoursorPosition = Bitmap.GetCoursorData(u16CoursorPosition);
+      auto const CopySize = u8Width * (BitmapType::LineHeight / 8);
+      if (pCoursorPosition && !(BitmapType::LineHeight % 8)) {
+        if (pData)
+          memcpy(pCoursorPosition, pData, CopySize);
+        else
+          memset(pCoursorPosition, 0, CopySize);
+        Bitmap.MarkDirtyAt(u16CoursorPosition, CopySize);
+      }
+    }
+  }
+
   const BitmapType &Bitmap;
   mutable const IFont *pCurrentFont;
   mutable unsigned short u16CoursorPosition;
+  mutable unsigned char u8CoursorShift;
 };
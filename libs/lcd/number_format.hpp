@@ -0,0 +1,109 @@
+#pragma once
+
+// Decimal conversion without division. The M0 has no divider, every / or %
+// by 10 ends up in the firmware IntDivide (see __wrap___udivsi3), and the
+// stock FormatString is a full printf. Digits here come from a shift-add
+// divide by 10 (Hacker's Delight 10-16), a dozen ALU ops per digit, or a
+// multiply by the reciprocal for small numbers.
+namespace NumberFormat
+{
+   // T, for parameters kept out of template argument deduction. Callers
+   // get unsigned int, the sim names a cycle counting integer instead
+   template <class T>
+   struct TSame
+   {
+      using Type = T;
+   };
+
+   // u32Number / 10, exact over the whole unsigned range
+   template <class TUInt = unsigned int>
+   constexpr TUInt DivU10(typename TSame<TUInt>::Type u32Number)
+   {
+      TUInt u32Q = (u32Number >> 1) + (u32Number >> 2);
+      u32Q += u32Q >> 4;
+      u32Q += u32Q >> 8;
+      u32Q += u32Q >> 16;
+      u32Q >>= 3;
+      TUInt u32R = u32Number - ((u32Q << 2) + u32Q) * 2;
+      return u32Q + ((u32R + 6) >> 4);
+   }
+
+   // s32Number / 10 by reciprocal multiply for 0 <= s32Number < SmallLimit,
+   // where the product still fits an int. One MULS and a shift
+   constexpr int SmallLimit = 40960;
+
+   template <class TInt = int>
+   constexpr TInt DivSmall10(typename TSame<TInt>::Type s32Number)
+   {
+      return (s32Number * 0xCCCD) >> 19;
+   }
+
+   // lowest Digits digits of u32Number, zero padded, not terminated.
+   // Returns what is left above them
+   template <unsigned char Digits>
+   inline unsigned int ToDigits(char *C8Dest, unsigned int u32Number)
+   {
+      for (unsigned char i = Digits; i--;)
+      {
+         auto const u32Q = DivU10(u32Number);
+         C8Dest[i] = '0' + (u32Number - ((u32Q << 2) + u32Q) * 2);
+         u32Number = u32Q;
+      }
+
+      return u32Number;
+   }
+
+   // like %u, returns the end of the terminated string
+   template <class TUInt = unsigned int>
+   inline char *Unsigned(char *C8Dest, typename TSame<TUInt>::Type u32Number)
+   {
+      char C8Digits[10];
+      char *pDigit = C8Digits + sizeof(C8Digits);
+      do
+      {
+         auto const u32Q = DivU10<TUInt>(u32Number);
+         *--pDigit = (char)('0' + (u32Number - ((u32Q << 2) + u32Q) * 2));
+         u32Number = u32Q;
+      } while (u32Number != 0);
+
+      while (pDigit < C8Digits + sizeof(C8Digits))
+      {
+         *C8Dest++ = *pDigit++;
+      }
+
+      *C8Dest = '\0';
+      return C8Dest;
+   }
+
+   // like %i
+   inline char *Signed(char *C8Dest, int s32Number)
+   {
+      if (s32Number < 0)
+      {
+         *C8Dest++ = '-';
+         return Unsigned(C8Dest, -(unsigned int)s32Number);
+      }
+
+      return Unsigned(C8Dest, (unsigned int)s32Number);
+   }
+
+   // like %0<Digits>u
+   template <unsigned char Digits>
+   inline char *Padded(char *C8Dest, unsigned int u32Number)
+   {
+      ToDigits<Digits>(C8Dest, u32Number);
+      C8Dest[Digits] = '\0';
+      return C8Dest + Digits;
+   }
+
+   // strcpy returning the end, to build labels in place of "%s" formats
+   inline char *String(char *C8Dest, const char *C8Src)
+   {
+      while ((*C8Dest = *C8Src++))
+      {
+         C8Dest++;
+      }
+
+      return C8Dest;
+   }
+}
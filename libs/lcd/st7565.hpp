@@ -0,0 +1,63 @@
+#pragma once
+#include "registers.hpp"
+
+// ST7565 on SPI0, same sequence as the stock fw full screen blit:
+// A0 (PB9) low for commands and high for data, it's left high when idle
+// so CViewManager still sees the lcd bus as free. Line 0 of the panel is
+// the status bar, gDisplayBuffer starts at line 1.
+namespace St7565
+{
+   static constexpr unsigned char ColumnOffset = 4;
+   static constexpr unsigned char MainScreenLine = 1;
+
+#ifndef UV_K5_SIM
+   inline void WriteByte(unsigned char u8Data)
+   {
+      while (SPI0->FIFOST & SPI_FIFOST_TFF)
+         ;
+      SPI0->WDR = u8Data;
+   }
+
+   // undocumented busy flag, bounded like in the stock fw
+   inline void WaitTxDone()
+   {
+      for (unsigned int i = 0; i < 100000 && (SPI0->IF & 0x20); i++)
+         ;
+   }
+
+   inline void BeginTransfer()
+   {
+      SPI0->CR &= ~SPI_CR_MSR_SSN;
+   }
+
+   inline void EndTransfer()
+   {
+      SPI0->CR |= SPI_CR_MSR_SSN;
+   }
+
+   inline void SelectColumnAndLine(unsigned char u8Column, unsigned char u8Line)
+   {
+      GPIOB->DATA &= ~GPIO_PIN_9;
+      WriteByte(0xB0 | u8Line);
+      WriteByte(0x10 | (u8Column >> 4));
+      WriteByte(u8Column & 0x0F);
+      WaitTxDone();
+   }
+
+   inline void WriteData(const unsigned char *p8Data, unsigned char u8Len)
+   {
+      GPIOB->DATA |= GPIO_PIN_9;
+      while (u8Len--)
+      {
+         WriteByte(*p8Data++);
+      }
+      WaitTxDone();
+   }
+#else
+   // sim/ keeps a copy of the panel and charges the bus time
+   void BeginTransfer();
+   void EndTransfer();
+   void SelectColumnAndLine(unsigned char u8Column, unsigned char u8Line);
+   void WriteData(const unsigned char *p8Data, unsigned char u8Len);
+#endif
+}
@@ -1,8 +1,16 @@
 #pragma once
 #include "lcd.hpp"
+#include "st7565.hpp"
 
+// Main screen (gDisplayBuffer, lcd lines 1..7). Keeps a dirty column span
+// per page, so FlushDirty can push only what changed since the last flush
+// instead of the whole 896 bytes. Everything drawn through SetPixel or
+// CDisplay is tracked, direct writes to the buffer have to call MarkDirty.
 struct TUV_K5Display : public IBitmap<128, 56, 8>
 {
+   static constexpr bool PagedLayout = true;
+   static constexpr unsigned char Pages = SizeY / LineHeight;
+
    constexpr TUV_K5Display(const unsigned char* p8ScreenData) : IBitmap(p8ScreenData){};
    bool GetPixel(unsigned char u8X, unsigned char u8Y) const override
    {
@@ -14,12 +22,17 @@ struct TUV_K5Display : public IBitmap<128, 56, 8>
       unsigned char u8Line = u8Y / LineHeight;
       unsigned char* pStart = (unsigned char*)pBuffStart;
       auto Position = GetCoursorPosition(u8Line, u8X);
-      if(Position > (SizeY / LineHeight) * SizeX)
+      if(Position >= Pages * SizeX)
       {
          return;
       }
-      
-      *(pStart + Position) |= 0b1 << (u8Y % LineHeight);
+
+      const unsigned char u8Bit = 0b1 << (u8Y % LineHeight);
+      if(!(*(pStart + Position) & u8Bit))
+      {
+         *(pStart + Position) |= u8Bit;
+         MarkDirty(u8Line, u8X, u8X + 1);
+      }
    }
 
    void* GetCoursorData(unsigned short u16CoursorPosition) const override
@@ -27,14 +40,115 @@ struct TUV_K5Display : public IBitmap<128, 56, 8>
       return (void*) (&pBuffStart[u16CoursorPosition]);
    }
 
-   void ClearAll() override
+   // marks only what was drawn, clearing an already blank screen is free
+   void ClearAll() const override
    {
-      memset((void*)pBuffStart, 0, (SizeY / LineHeight) * SizeX);
+      for(unsigned char u8Page = 0; u8Page < Pages; u8Page++)
+      {
+         const unsigned char* pPage = pBuffStart + u8Page * SizeX;
+         unsigned char u8Begin = 0;
+         unsigned char u8End = SizeX;
+         while(u8Begin < u8End && !pPage[u8Begin])
+         {
+            u8Begin++;
+         }
+
+         while(u8End > u8Begin && !pPage[u8End - 1])
+         {
+            u8End--;
+         }
+
+         if(u8Begin < u8End)
+         {
+            memset((void*)(pPage + u8Begin), 0, u8End - u8Begin);
+            MarkDirty(u8Page, u8Begin, u8End);
+         }
+      }
+   }
+
+   void MarkDirty(unsigned char u8Page, unsigned char u8Begin, unsigned char u8End) const
+   {
+      if(U8DirtyBegin[u8Page] >= U8DirtyEnd[u8Page])
+      {
+         U8DirtyBegin[u8Page] = u8Begin;
+         U8DirtyEnd[u8Page] = u8End;
+         return;
+      }
+
+      if(u8Begin < U8DirtyBegin[u8Page])
+         U8DirtyBegin[u8Page] = u8Begin;
+      if(u8End > U8DirtyEnd[u8Page])
+         U8DirtyEnd[u8Page] = u8End;
    }
+
+   // u16Position as returned by GetCoursorPosition, may span pages
+   void MarkDirtyAt(unsigned short u16Position, unsigned short u16Len) const
+   {
+      while(u16Len && u16Position < Pages * SizeX)
+      {
+         unsigned char u8Column = u16Position % SizeX;
+         unsigned short u16Cnt = SizeX - u8Column;
+         u16Cnt = u16Len < u16Cnt ? u16Len : u16Cnt;
+         MarkDirty(u16Position / SizeX, u8Column, u8Column + u16Cnt);
+         u16Position += u16Cnt;
+         u16Len -= u16Cnt;
+      }
+   }
+
+   void MarkAllDirty() const
+   {
+      for(unsigned char u8Page = 0; u8Page < Pages; u8Page++)
+      {
+         MarkDirty(u8Page, 0, SizeX);
+      }
+   }
+
+   bool IsDirty() const
+   {
+      for(unsigned char u8Page = 0; u8Page < Pages; u8Page++)
+      {
+         if(U8DirtyBegin[u8Page] < U8DirtyEnd[u8Page])
+            return true;
+      }
+
+      return false;
+   }
+
+   // replaces FlushFramebufferToScreen, only for the gDisplayBuffer instance
+   void FlushDirty() const
+   {
+      if(!IsDirty())
+      {
+         return;
+      }
+
+      St7565::BeginTransfer();
+      for(unsigned char u8Page = 0; u8Page < Pages; u8Page++)
+      {
+         auto const u8Begin = U8DirtyBegin[u8Page];
+         auto const u8End = U8DirtyEnd[u8Page];
+         if(u8Begin >= u8End)
+         {
+            continue;
+         }
+
+         St7565::SelectColumnAndLine(St7565::ColumnOffset + u8Begin,
+                                     St7565::MainScreenLine + u8Page);
+         St7565::WriteData(pBuffStart + GetCoursorPosition(u8Page, u8Begin),
+                           u8End - u8Begin);
+         U8DirtyBegin[u8Page] = U8DirtyEnd[u8Page] = 0;
+      }
+
+      St7565::EndTransfer();
+   }
+
+   mutable unsigned char U8DirtyBegin[Pages] = {};
+   mutable unsigned char U8DirtyEnd[Pages] = {};
 };
 
 struct TUV_K5StatusBar : public IBitmap<128, 8, 8>
 {
+   static constexpr bool PagedLayout = true;
    constexpr TUV_K5StatusBar(const unsigned char* p8ScreenData) : IBitmap(p8ScreenData){};
    bool GetPixel(unsigned char u8X, unsigned char u8Y) const override
    {
@@ -59,7 +173,7 @@ struct TUV_K5StatusBar : public IBitmap<128, 8, 8>
       return (void*) (&pBuffStart[u16CoursorPosition]);
    }
 
-   void ClearAll() override
+   void ClearAll() const override
    {
       memset((void*)pBuffStart, 0, (SizeY / LineHeight) * SizeX);
    }
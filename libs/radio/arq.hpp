@@ -0,0 +1,324 @@
+#pragma once
+#include <cstring>
+
+// selective repeat ARQ for messages longer than one packet. A message is
+// cut into up to MaxFragments fragments of FragmentLen bytes, each one
+// the payload of its own Packet:
+//
+//    control | fragment
+//
+// control holds the fragment index and count, the last frame of a burst
+// asks for an ack. The receiver answers with a bitmap of the fragments it
+// holds and the sender repeats only the missing ones, right away on that
+// ack or when AckTimeout and a random backoff run out. The Packet seq
+// numbers messages, frames of a message that was delivered already are
+// acked again but not delivered twice.
+//
+// Radio agnostic: Poll hands out the next frame to send, OnFrame takes a
+// received one, time is any tick counter the caller passes in
+template <unsigned char FragmentLen, unsigned char MaxFragments = 8>
+class CArq
+{
+   static_assert(MaxFragments && MaxFragments <= 8, "fragment bitmap is one byte");
+   static_assert(FragmentLen * MaxFragments < 0x100, "message length is one byte");
+
+public:
+   static constexpr unsigned char ControlSize = 1;
+   static constexpr unsigned char MaxFrameLen = ControlSize + FragmentLen;
+   static constexpr unsigned char MaxMessageLen = FragmentLen * MaxFragments;
+   // ticks, a FEC coded ack is ~250ms on air at 1200 baud plus the peer's
+   // poll latency, at the 10ms SysTick
+   static constexpr unsigned short AckTimeout = 100;
+   // quiet time after a frame of the peer that may be followed by another
+   // one, longer than a frame on air plus the peer's tx setup
+   static constexpr unsigned short HoldTime = AckTimeout / 2;
+   static constexpr unsigned char MaxRetries = 5;
+
+   enum eControl : unsigned char
+   {
+      Ack = 1 << 7,
+      AckRequest = 1 << 6,
+      CountShift = 3, // fragment count - 1 in 5:3
+      IndexMask = 0b111,
+   };
+
+   enum class eTxState : unsigned char
+   {
+      Idle,
+      Sending,
+      WaitAck,
+   };
+
+   struct TStats
+   {
+      unsigned short u16Sent;        // messages handed to Send
+      unsigned short u16Delivered;   // fully acked by the peer
+      unsigned short u16Failed;      // given up after MaxRetries
+      unsigned short u16Frames;      // data frames sent, repeats included
+      unsigned short u16Repeats;     // of those
+      unsigned short u16LastLatency; // ticks from Send to the last ack
+      unsigned short u16Received;    // messages delivered here
+      unsigned short u16Duplicates;  // frames of already delivered messages
+   };
+
+   CArq()
+       : TxState(eTxState::Idle),
+         u8TxSeq(0),
+         u8RxGot(0),
+         bRxDone(false),
+         bAckDue(false),
+         u32HoldUntil(0),
+         u16Random(0),
+         Stats{} {};
+
+   // p8Message has to stay unchanged until IsBusy is false
+   bool Send(const unsigned char *p8Message, unsigned char u8Len, unsigned int u32Now)
+   {
+      if (IsBusy() || !u8Len)
+      {
+         return false;
+      }
+
+      if (u8Len > MaxMessageLen)
+      {
+         u8Len = MaxMessageLen;
+      }
+
+      p8TxMessage = p8Message;
+      u8TxLen = u8Len;
+      // the first one starts at the time the user took to type it, so a
+      // restarted sender doesn't repeat the seq the peer saw last
+      u8TxSeq = Stats.u16Sent ? u8TxSeq + 1 : u32Now;
+      u8TxCount = (u8Len + FragmentLen - 1) / FragmentLen;
+      u8TxAcked = 0;
+      u8TxPending = GetAllMask(u8TxCount);
+      u8TxRetries = 0;
+      u32TxStart = u32Now;
+      u16Random ^= u32Now;
+      TxState = eTxState::Sending;
+      Stats.u16Sent++;
+      return true;
+   }
+
+   bool IsBusy() const { return TxState != eTxState::Idle; }
+
+   // Packet payload to send now into p8Frame (MaxFrameLen bytes), its seq
+   // into u8Seq. 0 when nothing is due
+   unsigned char Poll(unsigned int u32Now, unsigned char *p8Frame, unsigned char &u8Seq)
+   {
+      if (bAckDue)
+      {
+         bAckDue = false;
+         u8Seq = u8AckSeq;
+         p8Frame[0] = Ack;
+         p8Frame[1] = u8AckBitmap;
+         return ControlSize + 1;
+      }
+
+      // half duplex without carrier sense, the peer may still be talking
+      if ((int)(u32HoldUntil - u32Now) > 0)
+      {
+         return 0;
+      }
+
+      if (TxState == eTxState::WaitAck && (int)(u32Now - u32TxDeadline) >= 0)
+      {
+         RepeatMissing();
+      }
+
+      if (TxState != eTxState::Sending)
+      {
+         return 0;
+      }
+
+      unsigned char u8Idx = 0;
+      while (!(u8TxPending & (1 << u8Idx)))
+      {
+         u8Idx++;
+      }
+
+      u8TxPending &= ~(1 << u8Idx);
+      unsigned char u8Control = ((u8TxCount - 1) << CountShift) | u8Idx;
+      if (!u8TxPending)
+      {
+         u8Control |= AckRequest;
+         u32TxDeadline = u32Now + AckTimeout + GetBackoff();
+         TxState = eTxState::WaitAck;
+      }
+
+      auto const u8Offset = u8Idx * FragmentLen;
+      auto const u8Len = u8TxLen - u8Offset < FragmentLen ? u8TxLen - u8Offset : FragmentLen;
+      p8Frame[0] = u8Control;
+      memcpy(p8Frame + ControlSize, p8TxMessage + u8Offset, u8Len);
+      u8Seq = u8TxSeq;
+      Stats.u16Frames++;
+      return ControlSize + u8Len;
+   }
+
+   // received Packet payload, true when it completes a new message, which
+   // is then in GetRxMessage
+   bool OnFrame(unsigned char u8Seq, const unsigned char *p8Frame, unsigned char u8Len,
+                unsigned int u32Now)
+   {
+      if (u8Len < ControlSize)
+      {
+         return false;
+      }
+
+      // only the end of a burst leaves the channel to us right away
+      auto const u8Control = p8Frame[0];
+      u32HoldUntil = u32Now + ((u8Control & (Ack | AckRequest)) == AckRequest ? 0 : HoldTime);
+      if (u8Control & Ack)
+      {
+         OnAck(u8Seq, u8Len > ControlSize ? p8Frame[1] : 0, u32Now);
+         return false;
+      }
+
+      auto const u8Count = ((u8Control >> CountShift) & IndexMask) + 1;
+      auto const u8Idx = u8Control & IndexMask;
+      auto const u8FragmentLen = u8Len - ControlSize;
+      if (u8Idx >= u8Count || u8Count > MaxFragments || u8FragmentLen > FragmentLen)
+      {
+         return false;
+      }
+
+      // acks only answer the end of a burst, earlier the sender is still
+      // on air and would not hear them
+      bool const bAckRequest = u8Control & AckRequest;
+      if (bRxDone && u8Seq == u8RxSeq && u8Count == u8RxCount)
+      {
+         Stats.u16Duplicates++;
+         if (bAckRequest)
+         {
+            QueueAck(u8Seq, GetAllMask(u8Count));
+         }
+
+         return false;
+      }
+
+      if (bRxDone || u8Seq != u8RxSeq || u8Count != u8RxCount)
+      {
+         bRxDone = false;
+         u8RxSeq = u8Seq;
+         u8RxCount = u8Count;
+         u8RxGot = 0;
+      }
+
+      memcpy(U8RxMessage + u8Idx * FragmentLen, p8Frame + ControlSize, u8FragmentLen);
+      if (u8Idx == u8Count - 1)
+      {
+         u8RxLen = u8Idx * FragmentLen + u8FragmentLen;
+      }
+
+      u8RxGot |= 1 << u8Idx;
+      bool const bComplete = u8RxGot == GetAllMask(u8Count);
+      if (bAckRequest)
+      {
+         QueueAck(u8Seq, u8RxGot);
+      }
+
+      if (!bComplete)
+      {
+         return false;
+      }
+
+      U8RxMessage[u8RxLen] = '\0';
+      bRxDone = true;
+      Stats.u16Received++;
+      return true;
+   }
+
+   // NUL terminated once OnFrame returned true
+   const char *GetRxMessage() const { return (const char *)U8RxMessage; }
+   unsigned char GetRxLen() const { return u8RxLen; }
+   eTxState GetTxState() const { return TxState; }
+   const TStats &GetStats() const { return Stats; }
+
+private:
+   static constexpr unsigned char GetAllMask(unsigned char u8Count)
+   {
+      return (1 << u8Count) - 1;
+   }
+
+   // ends that repeat in step would collide every time, the range grows
+   // with each repeat
+   unsigned short GetBackoff()
+   {
+      u16Random = u16Random * 25173 + 13849;
+      return (u16Random >> 4) % (AckTimeout * (u8TxRetries + 1));
+   }
+
+   void OnAck(unsigned char u8Seq, unsigned char u8Bitmap, unsigned int u32Now)
+   {
+      if (TxState == eTxState::Idle || u8Seq != u8TxSeq)
+      {
+         return;
+      }
+
+      u8TxAcked |= u8Bitmap & GetAllMask(u8TxCount);
+      if (u8TxAcked == GetAllMask(u8TxCount))
+      {
+         Stats.u16Delivered++;
+         Stats.u16LastLatency = u32Now - u32TxStart;
+         TxState = eTxState::Idle;
+         return;
+      }
+
+      // an ack with holes answers the last burst, no point in waiting
+      if (TxState == eTxState::WaitAck)
+      {
+         RepeatMissing();
+      }
+   }
+
+   void RepeatMissing()
+   {
+      if (u8TxRetries++ >= MaxRetries)
+      {
+         Stats.u16Failed++;
+         TxState = eTxState::Idle;
+         return;
+      }
+
+      u8TxPending = GetAllMask(u8TxCount) & ~u8TxAcked;
+      for (unsigned char u8Pending = u8TxPending; u8Pending; u8Pending &= u8Pending - 1)
+      {
+         Stats.u16Repeats++;
+      }
+
+      TxState = eTxState::Sending;
+   }
+
+   void QueueAck(unsigned char u8Seq, unsigned char u8Bitmap)
+   {
+      bAckDue = true;
+      u8AckSeq = u8Seq;
+      u8AckBitmap = u8Bitmap;
+   }
+
+   eTxState TxState;
+   const unsigned char *p8TxMessage;
+   unsigned char u8TxLen;
+   unsigned char u8TxSeq;
+   unsigned char u8TxCount;
+   unsigned char u8TxAcked;
+   unsigned char u8TxPending;
+   unsigned char u8TxRetries;
+   unsigned int u32TxStart;
+   unsigned int u32TxDeadline;
+
+   unsigned char U8RxMessage[MaxMessageLen + 1];
+   unsigned char u8RxLen;
+   unsigned char u8RxSeq;
+   unsigned char u8RxCount;
+   unsigned char u8RxGot;
+   bool bRxDone;
+
+   bool bAckDue;
+   unsigned char u8AckSeq;
+   unsigned char u8AckBitmap;
+   unsigned int u32HoldUntil;
+   unsigned short u16Random;
+
+   TStats Stats;
+};
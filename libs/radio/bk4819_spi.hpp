@@ -0,0 +1,144 @@
+#pragma once
+#include "registers.hpp"
+
+// BK4819 3-wire bus bit-banged from the mod instead of the stock
+// BK4819Read / BK4819Write. Same framing: SCN (PC0) low for the
+// transfer, 8 bit address with bit 7 set for a read, 16 data bits, MSB
+// first, SDA (PC2) sampled by the chip on the rising edge of SCL (PC1).
+// The stock routines wait 1us on SysTick around every edge, here the SCL
+// half period is HalfBitCycles of core clock on top of the GPIO writes.
+//
+// The bus is shared with the stock fw: it holds SCN low during its own
+// transfers, callers check IsBusFree (CBK4819::IsLockedByOrgFw) before
+// using the bus in a handler. The lines are left idle like the stock fw
+// leaves them, SCN, SCL and SDA high.
+namespace Bk4819Spi
+{
+   static constexpr unsigned int Scn = GPIO_PIN_0;
+   static constexpr unsigned int Scl = GPIO_PIN_1;
+   static constexpr unsigned int Sda = GPIO_PIN_2;
+   static constexpr unsigned char ReadFlag = 0x80;
+
+#ifndef BK4819_SPI_HALF_BIT_CYCLES
+   // 1us at 48MHz, the wait the stock routines put around every edge, so
+   // the chip sees the stock setup and hold times. Their SysTick polling
+   // stretches that to ~170kHz SCL, this runs below 500kHz. Lower it per
+   // build once a radio has shown the chip keeps up
+   static constexpr unsigned char DefaultHalfBitCycles = 48;
+#else
+   static constexpr unsigned char DefaultHalfBitCycles = BK4819_SPI_HALF_BIT_CYCLES;
+#endif
+
+   inline bool IsBusFree() { return GPIOC->DATA & Scn; }
+
+#ifndef UV_K5_SIM
+   // longer waits loop, SUBS and a taken BNE are 4 cycles
+   template <unsigned char Cycles>
+   inline void Delay()
+   {
+      if constexpr (Cycles >= 8)
+      {
+         unsigned int u32Loops = Cycles / 4;
+         __asm volatile("1: subs %0, #1\n\tbne 1b" : "+l"(u32Loops));
+         Delay<Cycles % 4>();
+      }
+      else if constexpr (Cycles > 0)
+      {
+         __asm volatile("nop");
+         Delay<Cycles - 1>();
+      }
+   }
+
+   template <unsigned char HalfBitCycles>
+   inline void Begin()
+   {
+      GPIOC->DATA |= Scn;
+      GPIOC->DATA &= ~Scl;
+      Delay<HalfBitCycles>();
+      GPIOC->DATA &= ~Scn;
+   }
+
+   template <unsigned char HalfBitCycles>
+   inline void End()
+   {
+      GPIOC->DATA |= Scn;
+      Delay<HalfBitCycles>();
+      GPIOC->DATA |= Scl | Sda;
+   }
+
+   template <unsigned char HalfBitCycles>
+   inline void WriteBits(unsigned int u32Data, unsigned char u8Bits)
+   {
+      for (unsigned int u32Bit = 1u << (u8Bits - 1); u32Bit; u32Bit >>= 1)
+      {
+         if (u32Data & u32Bit)
+            GPIOC->DATA |= Sda;
+         else
+            GPIOC->DATA &= ~Sda;
+
+         Delay<HalfBitCycles>();
+         GPIOC->DATA |= Scl;
+         Delay<HalfBitCycles>();
+         GPIOC->DATA &= ~Scl;
+      }
+   }
+
+   // chip drives SDA after the falling edge, sampled before the rising one
+   template <unsigned char HalfBitCycles>
+   inline unsigned short ReadBits()
+   {
+      GPIO->PORTC_IE |= Sda;
+      GPIOC->DIR &= ~Sda;
+      Delay<HalfBitCycles>();
+
+      unsigned short u16Data = 0;
+      for (unsigned char i = 0; i < 16; i++)
+      {
+         u16Data = (u16Data << 1) | !!(GPIOC->DATA & Sda);
+         GPIOC->DATA |= Scl;
+         Delay<HalfBitCycles>();
+         GPIOC->DATA &= ~Scl;
+         Delay<HalfBitCycles>();
+      }
+
+      GPIO->PORTC_IE &= ~Sda;
+      GPIOC->DIR |= Sda;
+      return u16Data;
+   }
+
+   template <unsigned char HalfBitCycles = DefaultHalfBitCycles>
+   inline void Write(unsigned char u8Address, unsigned short u16Data)
+   {
+      Begin<HalfBitCycles>();
+      WriteBits<HalfBitCycles>(((unsigned int)u8Address << 16) | u16Data, 24);
+      End<HalfBitCycles>();
+   }
+
+   template <unsigned char HalfBitCycles = DefaultHalfBitCycles>
+   inline unsigned short Read(unsigned char u8Address)
+   {
+      Begin<HalfBitCycles>();
+      WriteBits<HalfBitCycles>(u8Address | ReadFlag, 8);
+      auto const u16Data = ReadBits<HalfBitCycles>();
+      End<HalfBitCycles>();
+      return u16Data;
+   }
+#else
+   // sim/ forwards to the BK4819 model and charges the bit time
+   void SimWrite(unsigned char u8Address, unsigned short u16Data,
+                 unsigned char u8HalfBitCycles);
+   unsigned short SimRead(unsigned char u8Address, unsigned char u8HalfBitCycles);
+
+   template <unsigned char HalfBitCycles = DefaultHalfBitCycles>
+   inline void Write(unsigned char u8Address, unsigned short u16Data)
+   {
+      SimWrite(u8Address, u16Data, HalfBitCycles);
+   }
+
+   template <unsigned char HalfBitCycles = DefaultHalfBitCycles>
+   inline unsigned short Read(unsigned char u8Address)
+   {
+      return SimRead(u8Address, HalfBitCycles);
+   }
+#endif
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+// forward error correction for Packet frames. Every nibble becomes an
+// extended Hamming(8,4) codeword (corrects 1 bit, detects 2), and each
+// 8 codeword block is sent as the transpose of its 8x8 bit matrix: air
+// byte i carries bit i of every codeword, so a burst of up to 8 bits
+// costs each codeword at most one bit. Rate 1/2, 4 frame bytes make 8
+// air bytes. Tables are constexpr and live in flash, a block is coded
+// in place
+namespace Fec
+{
+   static constexpr unsigned char BlockData = 4;
+   static constexpr unsigned char BlockAir = 8;
+
+   // decode table entry: nibble in 3:0, these flags above it
+   static constexpr unsigned char Corrected = 1 << 4;
+   static constexpr unsigned char Failed = 1 << 5;
+
+   constexpr unsigned char Encode(unsigned char u8Nibble)
+   {
+      unsigned char const d1 = u8Nibble >> 3 & 1, d2 = u8Nibble >> 2 & 1,
+                          d3 = u8Nibble >> 1 & 1, d4 = u8Nibble & 1;
+      unsigned char const p1 = d1 ^ d2 ^ d4, p2 = d1 ^ d3 ^ d4, p3 = d2 ^ d3 ^ d4;
+      unsigned char const p0 = d1 ^ d2 ^ d3 ^ d4 ^ p1 ^ p2 ^ p3;
+      return (u8Nibble << 4) | (p1 << 3) | (p2 << 2) | (p3 << 1) | p0;
+   }
+
+   struct TTables
+   {
+      unsigned char U8Encode[16];
+      unsigned char U8Decode[256];
+   };
+
+   constexpr TTables MakeTables()
+   {
+      TTables Tables = {};
+      for (unsigned char i = 0; i < 16; i++)
+      {
+         Tables.U8Encode[i] = Encode(i);
+      }
+
+      // nearest codeword, distance 4 code: 1 bit is corrected, 2 are not
+      for (unsigned short u16Word = 0; u16Word < 256; u16Word++)
+      {
+         unsigned char u8Best = 0, u8BestDistance = 8;
+         for (unsigned char i = 0; i < 16; i++)
+         {
+            unsigned char u8Diff = u16Word ^ Tables.U8Encode[i], u8Distance = 0;
+            for (; u8Diff; u8Diff &= u8Diff - 1)
+            {
+               u8Distance++;
+            }
+
+            if (u8Distance < u8BestDistance)
+            {
+               u8Best = i;
+               u8BestDistance = u8Distance;
+            }
+         }
+
+         Tables.U8Decode[u16Word] =
+             u8Best | (u8BestDistance == 1 ? Corrected : u8BestDistance > 1 ? Failed : 0);
+      }
+
+      return Tables;
+   }
+
+   inline constexpr TTables Tables = MakeTables();
+
+   constexpr unsigned short GetAirLen(unsigned short u16FrameLen)
+   {
+      return (u16FrameLen + BlockData - 1) / BlockData * BlockAir;
+   }
+
+   // longest frame u8BuffSize holds when blocks are decoded in place, the
+   // last one is still staged as 8 air bytes
+   constexpr unsigned char GetMaxFrameLen(unsigned char u8BuffSize)
+   {
+      return u8BuffSize < BlockAir ? 0 : (u8BuffSize - BlockAir) / BlockData * BlockData + BlockData;
+   }
+
+   // 8x8 bit matrix transpose, byte i is row i. Its own inverse
+   inline void Transpose(unsigned char *p8Block)
+   {
+      unsigned int x = (p8Block[0] << 24) | (p8Block[1] << 16) | (p8Block[2] << 8) | p8Block[3];
+      unsigned int y = (p8Block[4] << 24) | (p8Block[5] << 16) | (p8Block[6] << 8) | p8Block[7];
+      unsigned int t;
+
+      t = (x ^ (x >> 7)) & 0x00AA00AA;
+      x = x ^ t ^ (t << 7);
+      t = (y ^ (y >> 7)) & 0x00AA00AA;
+      y = y ^ t ^ (t << 7);
+      t = (x ^ (x >> 14)) & 0x0000CCCC;
+      x = x ^ t ^ (t << 14);
+      t = (y ^ (y >> 14)) & 0x0000CCCC;
+      y = y ^ t ^ (t << 14);
+      t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+      y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+      x = t;
+
+      for (unsigned char i = 0; i < 4; i++)
+      {
+         p8Block[i] = x >> (24 - 8 * i);
+         p8Block[4 + i] = y >> (24 - 8 * i);
+      }
+   }
+
+   // BlockData frame bytes into BlockAir air bytes, backwards so p8Air
+   // may be p8Data
+   inline void EncodeBlock(const unsigned char *p8Data, unsigned char *p8Air)
+   {
+      for (unsigned char i = BlockData; i--;)
+      {
+         auto const u8Data = p8Data[i];
+         p8Air[2 * i] = Tables.U8Encode[u8Data >> 4];
+         p8Air[2 * i + 1] = Tables.U8Encode[u8Data & 0xF];
+      }
+
+      Transpose(p8Air);
+   }
+
+   // BlockAir air bytes in, BlockData frame bytes out at the same address.
+   // Returns the codewords with a corrected bit. Ones beyond repair are
+   // added to u8Failed and left to the Packet crc
+   inline unsigned char DecodeBlock(unsigned char *p8Block, unsigned char &u8Failed)
+   {
+      Transpose(p8Block);
+      unsigned char u8Corrected = 0;
+      for (unsigned char i = 0; i < BlockData; i++)
+      {
+         auto const u8High = Tables.U8Decode[p8Block[2 * i]];
+         auto const u8Low = Tables.U8Decode[p8Block[2 * i + 1]];
+         u8Corrected += !!(u8High & Corrected) + !!(u8Low & Corrected);
+         u8Failed += !!(u8High & Failed) + !!(u8Low & Failed);
+         p8Block[i] = (u8High << 4) | (u8Low & 0xF);
+      }
+
+      return u8Corrected;
+   }
+} // namespace Fec
@@ -0,0 +1,216 @@
+#pragma once
+#include "flash.hpp"
+#include "packet.hpp"
+
+// messages kept over power cycles in a ring of flash Sectors at
+// BaseAddress. A sector starts with a sequence word, one above the
+// sector written before it, records follow back to back:
+//
+//    tag | len | crc16 of text | text, padded to a word with 0xFF
+//
+// Records go into the newest sector, when it is full the next one of the
+// ring is erased and takes over, dropping the oldest messages, so every
+// sector is erased as often as the others. Init reads the sequence words
+// only to find the newest sector, then walks its records for the free
+// space. A record cut by a power loss fails its crc and is skipped, a
+// torn header closes its sector. RAM holds the write position only, text
+// is read back from flash when asked for
+template <unsigned int BaseAddress, unsigned char Sectors>
+class CMessageLog
+{
+   static_assert(!(BaseAddress % Flash::SectorSize), "BaseAddress has to start a sector");
+   static_assert(Sectors >= 2, "a full sector has to stay while the next one is erased");
+
+public:
+   static constexpr unsigned char Tag = 0xA5;
+   static constexpr unsigned char HeaderSize = 4;
+
+   CMessageLog() : u8Sector(Sectors - 1), u16Offset(Flash::SectorSize){};
+
+   void Init()
+   {
+      u8Sector = Sectors - 1;
+      u16Offset = Flash::SectorSize;
+      bool bFound = false;
+      unsigned int u32Newest = 0;
+      for (unsigned char i = 0; i < Sectors; i++)
+      {
+         auto const u32Seq = Flash::ReadWord(GetSectorAddress(i));
+         if (u32Seq != Flash::Erased && (!bFound || (int)(u32Seq - u32Newest) > 0))
+         {
+            bFound = true;
+            u32Newest = u32Seq;
+            u8Sector = i;
+         }
+      }
+
+      if (!bFound)
+      {
+         return;
+      }
+
+      auto const u32Base = GetSectorAddress(u8Sector);
+      u16Offset = HeaderSize;
+      while (u16Offset + HeaderSize <= Flash::SectorSize)
+      {
+         auto const u32Header = Flash::ReadWord(u32Base + u16Offset);
+         if (u32Header == Flash::Erased)
+         {
+            return;
+         }
+
+         if ((u32Header & 0xFF) != Tag)
+         {
+            break;
+         }
+
+         u16Offset += GetRecordSize(u32Header >> 8);
+      }
+
+      u16Offset = Flash::SectorSize;
+   }
+
+   void Append(const char *C8Text, unsigned char u8Len)
+   {
+      if (!u8Len)
+      {
+         return;
+      }
+
+      auto const u16Size = GetRecordSize(u8Len);
+      if (u16Offset + u16Size > Flash::SectorSize)
+      {
+         OpenNextSector();
+      }
+
+      auto const u32Address = GetSectorAddress(u8Sector) + u16Offset;
+      u16Offset += u16Size;
+      // header first, text missing after a power loss fails the crc
+      auto const u16Crc = Packet::Crc16(Packet::CrcInit, (const unsigned char *)C8Text, u8Len);
+      Flash::ProgramWord(u32Address, Tag | (u8Len << 8) | ((unsigned int)u16Crc << 16));
+      for (unsigned char i = 0; i < u8Len; i += 4)
+      {
+         unsigned int u32Word = Flash::Erased;
+         for (unsigned char j = 0; j < 4 && i + j < u8Len; j++)
+         {
+            u32Word &= ~(0xFFu << (8 * j)) | ((unsigned int)(unsigned char)C8Text[i + j] << (8 * j));
+         }
+
+         Flash::ProgramWord(u32Address + HeaderSize + i, u32Word);
+      }
+   }
+
+   // u8Age 0 is the newest message. Copies it NUL terminated into C8Text,
+   // cut to u8Size - 1, returns its whole length, 0 when the log holds
+   // fewer
+   unsigned char Read(unsigned char u8Age, char *C8Text, unsigned char u8Size) const
+   {
+      auto const u32Newest = Flash::ReadWord(GetSectorAddress(u8Sector));
+      for (unsigned char i = 0; i < Sectors && u32Newest != Flash::Erased; i++)
+      {
+         auto const u8Older = (u8Sector + Sectors - i) % Sectors;
+         if (Flash::ReadWord(GetSectorAddress(u8Older)) != u32Newest - i)
+         {
+            break;
+         }
+
+         unsigned char u8Count;
+         FindRecord(u8Older, 0xFF, u8Count);
+         if (u8Age >= u8Count)
+         {
+            u8Age -= u8Count;
+            continue;
+         }
+
+         auto const u32Address = FindRecord(u8Older, u8Count - 1 - u8Age, u8Count);
+         auto const u8Len = (unsigned char)(Flash::ReadWord(u32Address) >> 8);
+         auto const u8Copy = u8Len < u8Size ? u8Len : u8Size - 1;
+         ReadText(u32Address + HeaderSize, C8Text, u8Copy);
+         C8Text[u8Copy] = '\0';
+         return u8Len;
+      }
+
+      C8Text[0] = '\0';
+      return 0;
+   }
+
+private:
+   static constexpr unsigned int GetSectorAddress(unsigned char u8Sector)
+   {
+      return BaseAddress + u8Sector * Flash::SectorSize;
+   }
+
+   static constexpr unsigned short GetRecordSize(unsigned char u8Len)
+   {
+      return HeaderSize + ((u8Len + 3) & ~3);
+   }
+
+   static void ReadText(unsigned int u32Address, char *C8Text, unsigned char u8Len)
+   {
+      for (unsigned char i = 0; i < u8Len; i += 4)
+      {
+         auto const u32Word = Flash::ReadWord(u32Address + i);
+         for (unsigned char j = 0; j < 4 && i + j < u8Len; j++)
+         {
+            C8Text[i + j] = u32Word >> (8 * j);
+         }
+      }
+   }
+
+   static bool IsIntact(unsigned int u32Address, unsigned int u32Header)
+   {
+      auto const u8Len = (unsigned char)(u32Header >> 8);
+      unsigned short u16Crc = Packet::CrcInit;
+      for (unsigned char i = 0; i < u8Len; i += 4)
+      {
+         auto const u32Word = Flash::ReadWord(u32Address + HeaderSize + i);
+         auto const u8Bytes = u8Len - i < 4 ? u8Len - i : 4;
+         u16Crc = Packet::Crc16(u16Crc, (const unsigned char *)&u32Word, u8Bytes);
+      }
+
+      return u16Crc == u32Header >> 16;
+   }
+
+   // address of the u8Index-th intact record of a sector, 0 when it holds
+   // fewer. u8Count is the number of intact records walked over
+   static unsigned int FindRecord(unsigned char u8Sector, unsigned char u8Index, unsigned char &u8Count)
+   {
+      u8Count = 0;
+      auto const u32Base = GetSectorAddress(u8Sector);
+      for (unsigned short u16At = HeaderSize; u16At + HeaderSize <= Flash::SectorSize;)
+      {
+         auto const u32Header = Flash::ReadWord(u32Base + u16At);
+         if ((u32Header & 0xFF) != Tag)
+         {
+            break;
+         }
+
+         auto const u32Address = u32Base + u16At;
+         u16At += GetRecordSize(u32Header >> 8);
+         if (u16At > Flash::SectorSize || !IsIntact(u32Address, u32Header))
+         {
+            continue;
+         }
+
+         if (u8Count++ == u8Index)
+         {
+            return u32Address;
+         }
+      }
+
+      return 0;
+   }
+
+   // an empty log has no sequence yet, Erased + 1 starts it at 0
+   void OpenNextSector()
+   {
+      auto const u32Seq = Flash::ReadWord(GetSectorAddress(u8Sector)) + 1;
+      u8Sector = (u8Sector + 1) % Sectors;
+      Flash::EraseSector(GetSectorAddress(u8Sector));
+      Flash::ProgramWord(GetSectorAddress(u8Sector), u32Seq);
+      u16Offset = HeaderSize;
+   }
+
+   unsigned char u8Sector;
+   unsigned short u16Offset;
+};
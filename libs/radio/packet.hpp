@@ -0,0 +1,86 @@
+#pragma once
+
+// variable length messenger frames on top of the BK4819 fsk fifo
+//
+//    len | kind | seq | payload[len] | crc hi | crc lo
+//
+// len counts the payload only, crc is CRC-16/CCITT (0xFFFF init) over the
+// header and payload. The receiver takes the frame length from the first
+// byte and stops there instead of waiting for a fixed size burst, so a
+// short message costs a short transmission. kind names the protocol the
+// payload speaks, a receiver drops frames of any other
+namespace Packet
+{
+   // a new payload format takes a new value, old ones are never reused
+   enum class eKind : unsigned char
+   {
+      Text = 1,      // src/messenger before TextCodec, the T9 text as typed
+      Arq = 2,       // libs/views messenger, CArq frames of TextCodec text
+      CodedText = 3, // src/messenger, the whole T9 text TextCodec coded
+   };
+
+   static constexpr unsigned char KindIdx = 1;
+   static constexpr unsigned char SeqIdx = 2;
+   static constexpr unsigned char HeaderSize = 3;
+   static constexpr unsigned char CrcSize = 2;
+   static constexpr unsigned char Overhead = HeaderSize + CrcSize;
+   // frame rounded up to whole fifo words still fits the 8 bit 0x5D length
+   static constexpr unsigned char MaxPayload = 0xFE - Overhead;
+   static constexpr unsigned short CrcInit = 0xFFFF;
+
+   constexpr unsigned short GetFrameLen(unsigned char u8PayloadLen)
+   {
+      return u8PayloadLen + Overhead;
+   }
+
+   inline unsigned short Crc16(unsigned short u16Crc, const unsigned char *p8Data,
+                               unsigned char u8Len)
+   {
+      while (u8Len--)
+      {
+         u16Crc ^= *p8Data++ << 8;
+         for (unsigned char i = 0; i < 8; i++)
+         {
+            u16Crc = (u16Crc & 0x8000) ? (u16Crc << 1) ^ 0x1021 : u16Crc << 1;
+         }
+      }
+
+      return u16Crc;
+   }
+
+   // byte u8Idx of the frame for p8Header and payload p8Payload, 0 past
+   // its end for the padding up to whole fifo words or Fec blocks
+   inline unsigned char GetFrameByte(const unsigned char *p8Header, const unsigned char *p8Payload,
+                                     unsigned char u8Len, unsigned short u16Crc,
+                                     unsigned char u8Idx)
+   {
+      if (u8Idx < HeaderSize)
+      {
+         return p8Header[u8Idx];
+      }
+
+      u8Idx -= HeaderSize;
+      if (u8Idx < u8Len)
+      {
+         return p8Payload[u8Idx];
+      }
+
+      u8Idx -= u8Len;
+      return u8Idx == 0 ? u16Crc >> 8 : u8Idx == 1 ? u16Crc & 0xFF : 0;
+   }
+
+   // u16Received is what came out of the fifo, it may run past the frame.
+   // Nothing past it is read whatever the len byte says
+   inline bool IsValid(const unsigned char *p8Frame, unsigned short u16Received, eKind Kind)
+   {
+      if (u16Received < Overhead || u16Received < GetFrameLen(p8Frame[0]) ||
+          p8Frame[KindIdx] != (unsigned char)Kind)
+      {
+         return false;
+      }
+
+      auto const u8CrcIdx = HeaderSize + p8Frame[0];
+      auto const u16Crc = Crc16(CrcInit, p8Frame, u8CrcIdx);
+      return p8Frame[u8CrcIdx] == (u16Crc >> 8) && p8Frame[u8CrcIdx + 1] == (u16Crc & 0xFF);
+   }
+} // namespace Packet
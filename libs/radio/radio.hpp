@@ -1,6 +1,11 @@
 #pragma once
+#include "bk4819_spi.hpp"
 #include "callback.hpp"
+#include "fec.hpp"
+#include "packet.hpp"
+#include "reg_sequence.hpp"
 #include "registers.hpp"
+#include "ring_buffer.hpp"
 #include "system.hpp"
 #include <functional>
 #include <cstring>
@@ -26,6 +31,7 @@ namespace Radio
    {
       FifoAlmostFull = 1 << 12,
       RxDone = 1 << 13,
+      FskTxFinished = 1 << 15,
    };
 
    enum class eFskMode : unsigned char
@@ -52,21 +58,179 @@ namespace Radio
        {0b101, 0b010, 0b000}, // NoaaSame
    };
 
+   constexpr unsigned short FskModeMask = (0b111 << 1) | (0b111 << 10) | (0b111 << 13);
+
+   constexpr TRegWrite FskModeWrite(eFskMode Mode)
+   {
+      auto const &Bits = ModesBits[(int)Mode];
+      return SetBits(0x58,
+                     (Bits.u8RxBandWidthBits << 1) | (Bits.u8RxModeBits << 10) |
+                         (Bits.u8TxModeBits << 13),
+                     FskModeMask);
+   }
+
+   // modem is switched off while the mode bits change
+   constexpr TRegWrite FskModeSequences[(int)eFskMode::ModesCount][2] = {
+       {Pulse(0x58, 0), FskModeWrite(eFskMode::Fsk1200)},
+       {Pulse(0x58, 0), FskModeWrite(eFskMode::Ffsk1200_1200_1800)},
+       {Pulse(0x58, 0), FskModeWrite(eFskMode::Ffsk1200_1200_2400)},
+       {Pulse(0x58, 0), FskModeWrite(eFskMode::NoaaSame)},
+   };
+
+   constexpr TRegWrite RxRestartSequence[] = {Pulse(0x30, 0), Restore(0x30)};
+
+   // fifo clear bit pulsed, then the fsk modem off
+   constexpr TRegWrite RxDoneSequence[] = {Pulse(0x59, 1 << 14), Restore(0x59),
+                                           SetBits(0x58, 0, 1)};
+
+   // 0x59 fsk control besides the enables: 7 byte preamble, sync length,
+   // what the stock fsk routines use
+   constexpr unsigned short FskControl = 0x0068;
+
+   // tx fifo cleared before it is filled, then tx enabled
+   constexpr TRegWrite TxPrepareSequence[] = {Set(0x3F, eIrq::FskTxFinished),
+                                              Set(0x59, (1 << 15) | FskControl),
+                                              Set(0x59, FskControl)};
+   constexpr TRegWrite TxStartSequence[] = {Set(0x59, (1 << 13) | (1 << 11) | FskControl)};
+   constexpr TRegWrite TxDoneSequence[] = {Set(0x02, 0), Set(0x3F, 0), Set(0x59, FskControl)};
+
+   // a short frame never reaches the stock 4 word threshold, every word
+   // is taken out as it comes
+   constexpr TRegWrite PacketRxSequence[] = {SetBits(0x5E, 1, 0b111)};
+
+   // 0x5D<15:8> holds the length - 1, kept to whole Fec blocks
+   constexpr unsigned char MaxAirLen = 0x100 - Fec::BlockAir;
+
    enum class eState : unsigned char
    {
       Idle,
       RxPending,
+      RxDone, // packet is complete, the consumer still empties the ring
    };
 
+   // received fsk bytes on their way from InterruptHandler to HandleRx,
+   // 1200 baud fills ~24 bytes in the 16 ticks of a background view
+   using TRxRing = CRingBuffer<32>;
+
    using CallbackRxDoneType = CCallback<void, unsigned char, bool>;
    class CBK4819
    {
       CallbackRxDoneType CallbackRxDone;
       unsigned char *p8RxBuff;
       unsigned char u8RxBuffSize;
+      TRxRing *pRxRing;
+      unsigned char u8RxReceived; // bytes taken out of the chip fifo
+      volatile unsigned char u8RxAirLen; // bytes to take, HandleRx shrinks it to the frame
+      volatile bool bRxCrcOk;
+      bool bRxPacket;
+      bool bRxFec;
+      Packet::eKind RxKind;
+      unsigned char u8RxStaged; // air bytes of the Fec block being received
+
+      // write-through copies of control registers, read-modify-write
+      // helpers only pay the SPI write. Stock fw can write them whenever it
+      // runs, so copies are dropped when it holds the bus and users
+      // invalidate them at the start of every SysTick
+      static constexpr unsigned char ShadowedRegs[] = {0x30, 0x31, 0x40, 0x47, 0x58, 0x59, 0x38, 0x39};
+      static constexpr unsigned char NotShadowed = 0xFF;
+      unsigned short U16Shadow[sizeof(ShadowedRegs)];
+      unsigned char u8ShadowValid;
+
+      static constexpr unsigned char GetShadowIdx(unsigned char u8Address)
+      {
+         for (unsigned char i = 0; i < sizeof(ShadowedRegs); i++)
+         {
+            if (ShadowedRegs[i] == u8Address)
+            {
+               return i;
+            }
+         }
+
+         return NotShadowed;
+      }
 
    public:
-      CBK4819() : State(eState::Idle), u16RxDataLen(0){};
+      CBK4819() : pRxRing(nullptr), bRxPacket(false), bRxFec(false), u8ShadowValid(0), State(eState::Idle), u16RxDataLen(0){};
+
+      unsigned short ReadRegister(unsigned char u8Address)
+      {
+         auto const u8Idx = GetShadowIdx(u8Address);
+         if (u8Idx == NotShadowed)
+         {
+            return Bk4819Spi::Read(u8Address);
+         }
+
+         if (!(u8ShadowValid & (1 << u8Idx)))
+         {
+            U16Shadow[u8Idx] = Bk4819Spi::Read(u8Address);
+            u8ShadowValid |= 1 << u8Idx;
+         }
+
+         return U16Shadow[u8Idx];
+      }
+
+      void WriteRegister(unsigned char u8Address, unsigned short u16Data)
+      {
+         Bk4819Spi::Write(u8Address, u16Data);
+         auto const u8Idx = GetShadowIdx(u8Address);
+         if (u8Idx != NotShadowed)
+         {
+            U16Shadow[u8Idx] = u16Data;
+            u8ShadowValid |= 1 << u8Idx;
+         }
+      }
+
+      void InvalidateShadow() { u8ShadowValid = 0; }
+
+      template <unsigned char Count>
+      void WriteSequence(const TRegWrite (&Writes)[Count])
+      {
+         WriteSequence(Writes, Count);
+      }
+
+      // streams a table in one pass. Masked entries take the other bits
+      // from the shadow, entries the shadow already holds are skipped
+      // unless they follow a Pulse of the same register. Pulsed registers
+      // are loaded into the shadow first, so they have to be shadowed
+      void WriteSequence(const TRegWrite *pWrites, unsigned char u8Count)
+      {
+         unsigned char u8Pulsed = NotShadowed;
+         for (; u8Count; u8Count--, pWrites++)
+         {
+            auto const &Write = *pWrites;
+            if (Write.u8Flags & TRegWrite::Pulse)
+            {
+               ReadRegister(Write.u8Address);
+               Bk4819Spi::Write(Write.u8Address, Write.u16Value);
+               u8Pulsed = Write.u8Address;
+               continue;
+            }
+
+            unsigned short u16Data = Write.u16Value;
+            if (Write.u16Mask != 0xFFFF)
+            {
+               u16Data |= ReadRegister(Write.u8Address) & ~Write.u16Mask;
+            }
+
+            if (Write.u8Address == u8Pulsed)
+            {
+               u8Pulsed = NotShadowed;
+            }
+            else if (IsShadowEqual(Write.u8Address, u16Data))
+            {
+               continue;
+            }
+
+            WriteRegister(Write.u8Address, u16Data);
+         }
+      }
+
+      bool IsShadowEqual(unsigned char u8Address, unsigned short u16Data)
+      {
+         auto const u8Idx = GetShadowIdx(u8Address);
+         return u8Idx != NotShadowed && (u8ShadowValid & (1 << u8Idx)) &&
+                U16Shadow[u8Idx] == u16Data;
+      }
 
       // void SetFrequency(unsigned int u32FrequencyD10)
       // {
@@ -75,78 +239,107 @@ namespace Radio
 
       static unsigned int GetFrequency()
       {
-         return (BK4819Read(0x39) << 16) | BK4819Read(0x38);
+         return (Bk4819Spi::Read(0x39) << 16) | Bk4819Spi::Read(0x38);
       }
 
       static signed short GetRssi()
       {
-         short s16Rssi = ((BK4819Read(0x67) >> 1) & 0xFF);
+         short s16Rssi = ((Bk4819Spi::Read(0x67) >> 1) & 0xFF);
          return s16Rssi - 160;
       }
 
-      bool IsTx() { return BK4819Read(0x30) & 0b10; }
+      bool IsTx() { return Bk4819Spi::Read(0x30) & 0b10; }
 
-      bool IsSqlOpen() { return BK4819Read(0x0C) & 0b10; }
+      bool IsSqlOpen() { return Bk4819Spi::Read(0x0C) & 0b10; }
 
-      static void SetFrequency(unsigned int u32Freq)
+      void SetFrequency(unsigned int u32Freq)
       {
-         BK4819Write(0x39, ((u32Freq >> 16) & 0xFFFF));
-         BK4819Write(0x38, (u32Freq & 0xFFFF));
-         auto OldReg = BK4819Read(0x30);
-         BK4819Write(0x30, 0);
-         BK4819Write(0x30, OldReg);
+         TRegWrite const Writes[] = {
+             Set(0x39, (u32Freq >> 16) & 0xFFFF), Set(0x38, u32Freq & 0xFFFF),
+             RxRestartSequence[0], RxRestartSequence[1]};
+         WriteSequence(Writes);
       }
 
+      // retune for sweeps, writes only the changed frequency words and
+      // power-cycles 0x30 only when the upper word changes. Steps within
+      // the lower word don't need the full restart, caller is expected to
+      // reset rx dsp (RSSI) after retuning anyway
+      void SetFrequencyFast(unsigned int u32Freq)
+      {
+         unsigned short const u16High = (u32Freq >> 16) & 0xFFFF;
+         unsigned short const u16Low = u32Freq & 0xFFFF;
+         bool const bHighChanged = !IsShadowEqual(0x39, u16High);
+         if (bHighChanged)
+         {
+            WriteRegister(0x39, u16High);
+         }
+
+         if (!IsShadowEqual(0x38, u16Low))
+         {
+            WriteRegister(0x38, u16Low);
+         }
+
+         if (bHighChanged)
+         {
+            RestartRx();
+         }
+      }
+
+      void RestartRx() { WriteSequence(RxRestartSequence); }
+
       void SetAgcTable(unsigned short *p16AgcTable)
       {
+         TRegWrite Writes[5];
          for (unsigned char i = 0; i < 5; i++)
          {
-            BK4819Write(0x10 + i, p16AgcTable[i]);
+            Writes[i] = Set(0x10 + i, p16AgcTable[i]);
          }
+
+         WriteSequence(Writes);
       }
 
       void GetAgcTable(unsigned short *p16AgcTable)
       {
          for (unsigned char i = 0; i < 5; i++)
          {
-            p16AgcTable[i] = BK4819Read(0x10 + i);
+            p16AgcTable[i] = Bk4819Spi::Read(0x10 + i);
          }
       }
 
       void SetDeviationPresent(unsigned char u8Present)
       {
-         auto Reg40 = BK4819Read(0x40);
+         auto Reg40 = ReadRegister(0x40);
          Reg40 &= ~(1 << 12);
          Reg40 |= (u8Present << 12);
-         BK4819Write(0x40, Reg40);
+         WriteRegister(0x40, Reg40);
       }
 
       void SetCalibration(unsigned char bOn)
       {
-         auto Reg30 = BK4819Read(0x31);
+         auto Reg30 = ReadRegister(0x31);
          Reg30 &= ~(1 << 3);
          Reg30 |= (bOn << 3);
-         BK4819Write(0x31, Reg30);
+         WriteRegister(0x31, Reg30);
       }
 
-      unsigned char GetAFAmplitude() { return BK4819Read(0x6F) & 0b1111111; }
+      unsigned char GetAFAmplitude() { return Bk4819Spi::Read(0x6F) & 0b1111111; }
 
-      static void ToggleAFDAC(bool enabled)
+      void ToggleAFDAC(bool enabled)
       {
-         auto Reg = BK4819Read(0x30);
+         auto Reg = ReadRegister(0x30);
          Reg &= ~(1 << 9);
          if (enabled)
             Reg |= (1 << 9);
-         BK4819Write(0x30, Reg);
+         WriteRegister(0x30, Reg);
       }
 
-      static void ToggleRXDSP(bool enabled)
+      void ToggleRXDSP(bool enabled)
       {
-         auto Reg = BK4819Read(0x30);
+         auto Reg = ReadRegister(0x30);
          Reg &= ~1;
          if (enabled)
             Reg |= 1;
-         BK4819Write(0x30, Reg);
+         WriteRegister(0x30, Reg);
       }
 
       void SendSyncAirCopyMode72(unsigned char *p8Data)
@@ -155,83 +348,207 @@ namespace Radio
          AirCopyFskSetup();
          AirCopy72(p8Data);
          BK4819SetGpio(1, false);
+         InvalidateShadow(); // stock routines above rewrite 0x30 / 0x58
       }
 
-      void DisablePa() { BK4819Write(0x30, BK4819Read(0x30) & ~0b1010); }
-
-      void SetFskMode(eFskMode Mode)
+      // Packet frame written straight into the tx fifo, the air time
+      // follows the payload length instead of a fixed 72 byte burst.
+      // bFec sends it Fec coded, twice as long
+      void SendSyncPacket(Packet::eKind Kind, unsigned char u8Seq, const unsigned char *p8Payload,
+                          unsigned char u8Len, bool bFec = false)
       {
-         auto const &ModeParams = ModesBits[(int)Mode];
-         auto Reg58 = BK4819Read(0x58);
-         Reg58 &= ~((0b111 << 1) | (0b111 << 10) | (0b111 << 13));
-         Reg58 |= (ModeParams.u8RxBandWidthBits << 1) |
-                  (ModeParams.u8RxModeBits << 10) | (ModeParams.u8TxModeBits << 13);
-         BK4819Write(0x58, 0);
-         BK4819Write(0x58, Reg58);
+         unsigned char const u8MaxPayload =
+             bFec ? MaxAirLen / 2 - Packet::Overhead : Packet::MaxPayload;
+         if (u8Len > u8MaxPayload)
+         {
+            u8Len = u8MaxPayload;
+         }
+
+         BK4819ConfigureAndStartTxFsk();
+         AirCopyFskSetup();
+         InvalidateShadow();
+
+         // whole words go out, an odd frame gets a pad byte
+         auto const u16FrameLen = Packet::GetFrameLen(u8Len);
+         unsigned char const u8AirLen = bFec ? Fec::GetAirLen(u16FrameLen) : (u16FrameLen + 1) & ~1;
+         TRegWrite const LenWrite = SetBits(0x5D, (u8AirLen - 1) << 8, 0xFF00);
+         WriteSequence(&LenWrite, 1);
+         DelayMs(20);
+         WriteSequence(TxPrepareSequence);
+
+         unsigned char const U8Header[Packet::HeaderSize] = {u8Len, (unsigned char)Kind, u8Seq};
+         auto const u16Crc = Packet::Crc16(Packet::Crc16(Packet::CrcInit, U8Header, sizeof(U8Header)),
+                                           p8Payload, u8Len);
+
+         // a word or a Fec block at a time, low byte first the way
+         // DrainRxFifo takes them out
+         unsigned char const u8ChunkLen = bFec ? Fec::BlockData : 2;
+         unsigned char const u8ChunkAirLen = bFec ? Fec::BlockAir : 2;
+         for (unsigned char i = 0; i < u16FrameLen; i += u8ChunkLen)
+         {
+            unsigned char U8Air[Fec::BlockAir];
+            for (unsigned char j = 0; j < u8ChunkLen; j++)
+            {
+               U8Air[j] = Packet::GetFrameByte(U8Header, p8Payload, u8Len, u16Crc, i + j);
+            }
+
+            if (bFec)
+            {
+               Fec::EncodeBlock(U8Air, U8Air);
+            }
+
+            for (unsigned char j = 0; j < u8ChunkAirLen; j += 2)
+            {
+               Bk4819Spi::Write(0x5F, U8Air[j] | (U8Air[j + 1] << 8));
+            }
+         }
+
+         DelayMs(20);
+         WriteSequence(TxStartSequence);
+         // a byte is 6.7ms at 1200 baud, 1.5 polls of 5ms. Preamble and
+         // sync word add 11 bytes, a longest frame ~1.8s
+         unsigned short const u16AirBytes = u8AirLen + 11;
+         for (unsigned short u16Timeout = u16AirBytes + (u16AirBytes >> 1) + 10; u16Timeout; u16Timeout--)
+         {
+            if (Bk4819Spi::Read(0x0C) & 1)
+            {
+               break;
+            }
+
+            DelayMs(5);
+         }
+
+         WriteSequence(TxDoneSequence);
+         BK4819SetGpio(1, false);
+         InvalidateShadow();
       }
 
+      void DisablePa() { WriteRegister(0x30, ReadRegister(0x30) & ~0b1010); }
+
+      void SetFskMode(eFskMode Mode) { WriteSequence(FskModeSequences[(int)Mode]); }
+
       void FixIrqEnRegister() // original firmware overrides IRQ_EN reg, so we need
                               // to reenable it
       {
-         auto const OldIrqEnReg = BK4819Read(0x3F);
+         auto const OldIrqEnReg = Bk4819Spi::Read(0x3F);
          if ((OldIrqEnReg & (eIrq::FifoAlmostFull | eIrq::RxDone)) !=
              (eIrq::FifoAlmostFull | eIrq::RxDone))
          {
-            BK4819Write(0x3F, OldIrqEnReg | eIrq::FifoAlmostFull | eIrq::RxDone);
+            Bk4819Spi::Write(0x3F, OldIrqEnReg | eIrq::FifoAlmostFull | eIrq::RxDone);
          }
       }
 
-      void RecieveAsyncAirCopyMode(unsigned char *p8Data, unsigned char u8DataLen,
-                                   CallbackRxDoneType Callback)
+      // u8DataLen is the packet length, Callback runs from HandleRx
+      void RecieveAsyncAirCopyMode(TRxRing &Ring, unsigned char *p8Data,
+                                   unsigned char u8DataLen, CallbackRxDoneType Callback)
       {
-         if (!p8Data || !u8DataLen)
-         {
-            return;
-         }
-
-         CallbackRxDone = Callback;
-         p8RxBuff = p8Data;
-         u8RxBuffSize = u8DataLen;
-         u16RxDataLen = 0;
-
-         AirCopyFskSetup();
-         BK4819ConfigureAndStartRxFsk();
-         State = eState::RxPending;
+         bRxFec = false;
+         StartRx(Ring, p8Data, u8DataLen, Callback, false);
       }
 
-      void DisableFskModem()
+      // whole frame lands in p8Data, Callback gets the payload length and
+      // whether the Packet crc and kind match. u8DataLen caps the frame,
+      // 0x5D is set to it so the modem keeps listening for the longest
+      // one. With bFec the blocks are decoded in p8Data as they come, see
+      // Fec::GetMaxFrameLen
+      void RecieveAsyncPacket(TRxRing &Ring, unsigned char *p8Data,
+                              unsigned char u8DataLen, CallbackRxDoneType Callback,
+                              Packet::eKind Kind, bool bFec = false)
       {
-         auto const FskSettings = BK4819Read(0x58);
-         BK4819Write(0x58, FskSettings & ~1);
+         bRxFec = bFec;
+         RxKind = Kind;
+         StartRx(Ring, p8Data, u8DataLen, Callback, true);
       }
 
-      void ClearRxFifoBuff()
-      {
-         auto const Reg59 = BK4819Read(0x59);
-         BK4819Write(0x59, 1 << 14);
-         BK4819Write(0x59, Reg59);
-      }
+      void DisableFskModem() { WriteSequence(&RxDoneSequence[2], 1); }
+
+      void ClearRxFifoBuff() { WriteSequence(RxDoneSequence, 2); }
 
       unsigned short GetIrqReg()
       {
-         BK4819Write(0x2, 0);
-         return BK4819Read(0x2);
+         Bk4819Spi::Write(0x2, 0);
+         return Bk4819Spi::Read(0x2);
       }
 
-      bool CheckCrc() { return BK4819Read(0x0B) & (1 << 4); }
+      bool CheckCrc() { return Bk4819Spi::Read(0x0B) & (1 << 4); }
 
-      bool IsLockedByOrgFw() { return !(GPIOC->DATA & 0b1); }
+      bool IsLockedByOrgFw()
+      {
+         if (Bk4819Spi::IsBusFree())
+         {
+            return false;
+         }
+
+         InvalidateShadow();
+         return true;
+      }
 
       unsigned short u16DebugIrq;
 
-      void HandleRxDone()
+      // consumer side, called from the code that owns the rx buffer: moves
+      // the bytes InterruptHandler queued into it and reports the packet
+      // once the ring is empty. Doesn't touch the bus
+      void HandleRx()
       {
-         ClearRxFifoBuff();
-         DisableFskModem();
-         State = eState::Idle;
-         CallbackRxDone(u16RxDataLen, CheckCrc());
+         if (!pRxRing)
+         {
+            return;
+         }
+
+         unsigned char u8Data;
+         while (pRxRing->Pop(u8Data))
+         {
+            if (u16RxDataLen + u8RxStaged >= u8RxBuffSize)
+            {
+               continue;
+            }
+
+            p8RxBuff[u16RxDataLen + u8RxStaged++] = u8Data;
+            if (!bRxFec)
+            {
+               u16RxDataLen += u8RxStaged;
+               u8RxStaged = 0;
+            }
+            else if (u8RxStaged == Fec::BlockAir)
+            {
+               u8RxCorrected += Fec::DecodeBlock(p8RxBuff + u16RxDataLen, u8RxFailed);
+               u16RxDataLen += Fec::BlockData;
+               u8RxStaged = 0;
+            }
+
+            // len of a packet tells the producer where to stop
+            if (bRxPacket && u16RxDataLen)
+            {
+               auto const u16FrameLen = Packet::GetFrameLen(p8RxBuff[0]);
+               auto const u16AirLen = bRxFec ? Fec::GetAirLen(u16FrameLen) : u16FrameLen;
+               if (u16AirLen < u8RxAirLen)
+               {
+                  u8RxAirLen = u16AirLen;
+               }
+            }
+         }
+
+         if (State == eState::RxDone && pRxRing->IsEmpty())
+         {
+            State = eState::Idle;
+            if (bRxPacket)
+            {
+               // a broken len byte doesn't reach the callback, only a
+               // frame within the u16RxDataLen bytes stored passes
+               bool const bValid = Packet::IsValid(p8RxBuff, u16RxDataLen, RxKind);
+               CallbackRxDone(bValid ? p8RxBuff[0] : 0, bValid);
+               return;
+            }
+
+            CallbackRxDone(u16RxDataLen, bRxCrcOk);
+         }
       }
 
+      // producer side, polls the BK4819 irq flags. The UV-K5 doesn't route
+      // a BK4819 interrupt line to the mcu (stock fw polls 0x0C as well),
+      // so mods call it at the start of every SysTick, before any view
+      // prescaler. A board that wires it can call it from the weak
+      // Irq<n>_Handler of that line in vtable.s instead
       void InterruptHandler()
       {
          if (IsLockedByOrgFw())
@@ -239,50 +556,116 @@ namespace Radio
             return;
          }
 
+         InvalidateShadow();
+
          if (State == eState::RxPending)
          {
             FixIrqEnRegister();
-            if (!(BK4819Read(0x0C) & 1)) // irq request indicator
+            if (!(Bk4819Spi::Read(0x0C) & 1)) // irq request indicator
             {
                return;
             }
 
             auto const IrqReg = GetIrqReg();
 
-            if (IrqReg & eIrq::RxDone)
+            if (IrqReg & eIrq::FifoAlmostFull)
             {
-               // HandleRxDone();
+               // 0x5E<2:0> is the almost full threshold in words
+               DrainRxFifo(Bk4819Spi::Read(0x5E) & 0b111);
+               if (bRxPacket && u8RxReceived >= u8RxAirLen)
+               {
+                  CompleteRx();
+               }
             }
 
-            if (IrqReg & eIrq::FifoAlmostFull)
+            // a packet may be complete already
+            if ((IrqReg & eIrq::RxDone) && State == eState::RxPending)
             {
-               HandleFifoAlmostFull();
+               HandleRxDone();
             }
          }
       }
 
-      eState State;
+      volatile eState State;
       unsigned short u16RxDataLen;
+      unsigned char u8RxCorrected; // Fec codewords repaired in the last packet
+      unsigned char u8RxFailed;    // and the ones beyond repair
 
    private:
-      void HandleFifoAlmostFull()
+      void StartRx(TRxRing &Ring, unsigned char *p8Data, unsigned char u8DataLen,
+                   CallbackRxDoneType Callback, bool bPacket)
       {
-         for (unsigned char i = 0; i < 4; i++)
+         if (!p8Data || !u8DataLen)
          {
-            auto const RxData = BK4819Read(0x5F);
-            if (p8RxBuff && u16RxDataLen < u8RxBuffSize - 2)
+            return;
+         }
+
+         State = eState::Idle; // InterruptHandler leaves the ring alone
+         bRxPacket = bPacket;
+         CallbackRxDone = Callback;
+         p8RxBuff = p8Data;
+         u8RxBuffSize = u8DataLen;
+         u16RxDataLen = 0;
+         u8RxReceived = 0;
+         u8RxStaged = 0;
+         u8RxCorrected = 0;
+         u8RxFailed = 0;
+         u8RxAirLen = u8DataLen;
+         pRxRing = &Ring;
+         Ring.Clear();
+
+         AirCopyFskSetup();
+         BK4819ConfigureAndStartRxFsk();
+         InvalidateShadow();
+         if (bPacket)
+         {
+            if (bRxFec)
             {
-               memcpy(p8RxBuff + u16RxDataLen, &RxData, 2);
+               auto const u16AirLen = Fec::GetAirLen(Fec::GetMaxFrameLen(u8DataLen));
+               u8RxAirLen = u16AirLen < MaxAirLen ? u16AirLen : MaxAirLen;
             }
 
-            u16RxDataLen += 2;
+            TRegWrite const LenWrite = SetBits(0x5D, (u8RxAirLen - 1) << 8, 0xFF00);
+            WriteSequence(&LenWrite, 1);
+            WriteSequence(PacketRxSequence);
          }
 
-         if (u16RxDataLen >= u8RxBuffSize)
+         State = eState::RxPending;
+      }
+
+      // words come low byte first, bytes past the packet length are read
+      // out of the fifo but not queued
+      void DrainRxFifo(unsigned char u8Words)
+      {
+         while (u8Words--)
          {
-            State = eState::Idle;
-            CallbackRxDone(u8RxBuffSize, CheckCrc());
+            auto const u16RxData = Bk4819Spi::Read(0x5F);
+            for (unsigned char i = 0; i < 2 && u8RxReceived < u8RxAirLen; i++)
+            {
+               // a full ring loses the byte, HandleRx runs too rarely
+               pRxRing->Push(u16RxData >> (i << 3));
+               u8RxReceived++;
+            }
          }
       }
+
+      // words short of the almost full threshold are still in the fifo,
+      // crc is read before the fifo clear and modem off
+      void HandleRxDone()
+      {
+         if (u8RxReceived < u8RxAirLen)
+         {
+            DrainRxFifo((u8RxAirLen - u8RxReceived + 1) >> 1);
+         }
+
+         bRxCrcOk = CheckCrc();
+         CompleteRx();
+      }
+
+      void CompleteRx()
+      {
+         WriteSequence(RxDoneSequence);
+         State = eState::RxDone;
+      }
    };
 } // namespace Radio
@@ -0,0 +1,48 @@
+#pragma once
+
+// BK4819 register sequences as data. Mode switches are tables of
+// address / value / mask entries, built at compile time where the values
+// are known, and CBK4819::WriteSequence streams a whole table in one call
+// instead of a chain of read-modify-write helpers.
+namespace Radio
+{
+   struct TRegWrite
+   {
+      enum eFlags : unsigned char
+      {
+         None = 0,
+         Pulse = 1 << 0, // written as is, the register keeps its value after
+      };
+
+      unsigned char u8Address;
+      unsigned char u8Flags;
+      unsigned short u16Value;
+      unsigned short u16Mask; // bits of u16Value to write, others are kept
+   };
+
+   // whole register
+   constexpr TRegWrite Set(unsigned char u8Address, unsigned short u16Value)
+   {
+      return {u8Address, TRegWrite::None, u16Value, 0xFFFF};
+   }
+
+   // masked bits, the rest comes from the shadow or a read
+   constexpr TRegWrite SetBits(unsigned char u8Address, unsigned short u16Value,
+                               unsigned short u16Mask)
+   {
+      return {u8Address, TRegWrite::None, (unsigned short)(u16Value & u16Mask), u16Mask};
+   }
+
+   // strobe like 0x30 = 0 before rx restart, the next entry for the same
+   // register is never skipped
+   constexpr TRegWrite Pulse(unsigned char u8Address, unsigned short u16Value)
+   {
+      return {u8Address, TRegWrite::Pulse, u16Value, 0xFFFF};
+   }
+
+   // writes the current value back, closes a Pulse
+   constexpr TRegWrite Restore(unsigned char u8Address)
+   {
+      return {u8Address, TRegWrite::None, 0, 0};
+   }
+} // namespace Radio
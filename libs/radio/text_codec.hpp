@@ -0,0 +1,496 @@
+#pragma once
+
+// compact coding of messenger text. The T9 alphabet fits 6 bit symbols:
+// space, a-z, 0-9, the punctuation of key 1, Shift (next letter upper
+// case), 17 letter pairs frequent in English and Polish chat and Escape,
+// followed by the raw char, for anything else. The symbols are sent
+// either packed as they are or with a static Huffman code:
+//
+//    codec | bits
+//
+// the sender picks the shortest, plain text included. Bits go msb first
+// and are padded with ones to a whole byte. Escape is all ones in both
+// codes, so the padding never completes a symbol and the text ends where
+// the bits do. Tables are constexpr and live in flash
+namespace TextCodec
+{
+   enum eCodec : unsigned char
+   {
+      Plain,
+      Packed,
+      Huffman,
+   };
+
+   static constexpr unsigned char HeaderSize = 1;
+   static constexpr unsigned char SymbolBits = 6;
+   static constexpr unsigned char Symbols = 1 << SymbolBits;
+   static constexpr unsigned char RawBits = 8;
+
+   // symbol is the index
+   static constexpr char C8Singles[] = " abcdefghijklmnopqrstuvwxyz0123456789.,'!?/#$";
+   static constexpr unsigned char Shift = sizeof(C8Singles) - 1;
+   static constexpr char C8Pairs[][2] = {
+       {'e', ' '}, {'t', 'h'}, {'e', 's'}, {'a', ' '}, {'y', ' '}, {'n', ' '},
+       {'t', ' '}, {'a', 'r'}, {'i', 'e'}, {'d', 'z'}, {'o', ' '}, {'o', 'u'},
+       {'i', 'n'}, {'p', 'o'}, {'s', ' '}, {'t', 'e'}, {'s', 'z'}};
+   static constexpr unsigned char FirstPair = Shift + 1;
+   static constexpr unsigned char Escape = Symbols - 1;
+   static_assert(FirstPair + sizeof(C8Pairs) / sizeof(*C8Pairs) == Escape, "symbols have to fill 6 bits");
+
+   // Huffman code lengths from symbol counts of mixed English/Polish chat
+   // text, Escape is the rarest
+   static constexpr unsigned char MaxCodeLen = 11;
+   static constexpr unsigned char U8CodeLens[Symbols] = {
+       3,                                                                      // space
+       4, 6, 5, 5, 5, 7, 6, 6, 5, 6, 6, 5, 5, 5, 4, 6, 8, 5, 5, 5, 6, 8, 5, 9, 6, 6, // a-z
+       10, 10, 9, 9, 11, 10, 10, 10, 10, 10,                                   // 0-9
+       8, 6, 10, 9, 7, 10, 10, 10,                                             // .,'!?/#$
+       6,                                                                      // Shift
+       5, 6, 7, 6, 6, 7, 7, 7, 6, 7, 7, 7, 7, 7, 7, 7, 7,                      // pairs
+       11,                                                                     // Escape
+   };
+
+   struct TTables
+   {
+      // ascii to its single symbol, Escape when there is none
+      unsigned char U8SymbolOf[128];
+      unsigned short U16Codes[Symbols];
+      // canonical decoding: codes per length, symbols by length
+      unsigned char U8LenCount[MaxCodeLen + 1];
+      unsigned char U8Sorted[Symbols];
+   };
+
+   constexpr TTables MakeTables()
+   {
+      TTables Tables = {};
+      for (unsigned char i = 0; i < 128; i++)
+      {
+         Tables.U8SymbolOf[i] = Escape;
+      }
+
+      for (unsigned char i = 0; i < Shift; i++)
+      {
+         Tables.U8SymbolOf[(unsigned char)C8Singles[i]] = i;
+      }
+
+      for (unsigned char i = 0; i < Symbols; i++)
+      {
+         Tables.U8LenCount[U8CodeLens[i]]++;
+      }
+
+      unsigned short U16NextCode[MaxCodeLen + 1] = {};
+      unsigned char U8NextSorted[MaxCodeLen + 1] = {};
+      for (unsigned char u8Len = 1; u8Len < MaxCodeLen; u8Len++)
+      {
+         U16NextCode[u8Len + 1] = (U16NextCode[u8Len] + Tables.U8LenCount[u8Len]) << 1;
+         U8NextSorted[u8Len + 1] = U8NextSorted[u8Len] + Tables.U8LenCount[u8Len];
+      }
+
+      for (unsigned char i = 0; i < Symbols; i++)
+      {
+         auto const u8Len = U8CodeLens[i];
+         Tables.U16Codes[i] = U16NextCode[u8Len]++;
+         Tables.U8Sorted[U8NextSorted[u8Len]++] = i;
+      }
+
+      return Tables;
+   }
+
+   inline constexpr TTables Tables = MakeTables();
+
+   constexpr bool IsComplete()
+   {
+      unsigned int u32Sum = 0;
+      for (auto const u8Len : U8CodeLens)
+      {
+         u32Sum += 1 << (MaxCodeLen - u8Len);
+      }
+
+      return u32Sum == 1 << MaxCodeLen;
+   }
+
+   static_assert(IsComplete(), "Huffman code lengths have to make a complete code");
+   static_assert(U8CodeLens[Escape] == MaxCodeLen && Tables.U16Codes[Escape] == (1 << MaxCodeLen) - 1,
+                 "Escape has to be the all ones code");
+
+   // walks the symbols of a text, Sink takes Symbol(u8Symbol) and
+   // Raw(u8Char) after an Escape
+   template <typename TSink>
+   void ForEachSymbol(const char *C8Text, unsigned char u8Len, TSink &Sink)
+   {
+      for (unsigned char i = 0; i < u8Len;)
+      {
+         unsigned char u8Char = C8Text[i];
+         if (u8Char >= 'A' && u8Char <= 'Z')
+         {
+            Sink.Symbol(Shift);
+            u8Char += 'a' - 'A';
+         }
+
+         unsigned char u8Pair = 0;
+         while (i + 1 < u8Len && u8Pair < sizeof(C8Pairs) / sizeof(*C8Pairs) &&
+                (C8Pairs[u8Pair][0] != u8Char || C8Pairs[u8Pair][1] != C8Text[i + 1]))
+         {
+            u8Pair++;
+         }
+
+         if (i + 1 < u8Len && u8Pair < sizeof(C8Pairs) / sizeof(*C8Pairs))
+         {
+            Sink.Symbol(FirstPair + u8Pair);
+            i += 2;
+            continue;
+         }
+
+         auto const u8Symbol = u8Char < 128 ? Tables.U8SymbolOf[u8Char] : Escape;
+         Sink.Symbol(u8Symbol);
+         if (u8Symbol == Escape)
+         {
+            Sink.Raw(C8Text[i]);
+         }
+
+         i++;
+      }
+   }
+
+   // for coding in place: how many whole bytes of a code run ahead of
+   // the chars they come from (u16Lead) and how many chars ahead of the
+   // bytes they are decoded from (u16Trail)
+   struct TRoom
+   {
+      unsigned short u16Lead;
+      unsigned short u16Trail;
+
+      void Update(unsigned short u16Bits, unsigned char u8CharsBefore, unsigned char u8CharsAfter)
+      {
+         unsigned short const u16Bytes = u16Bits / 8;
+         if (u16Bytes > u8CharsBefore && u16Bytes - u8CharsBefore > u16Lead)
+         {
+            u16Lead = u16Bytes - u8CharsBefore;
+         }
+
+         if (u8CharsAfter > u16Bytes && u8CharsAfter - u16Bytes > u16Trail)
+         {
+            u16Trail = u8CharsAfter - u16Bytes;
+         }
+      }
+   };
+
+   struct TBitCounter
+   {
+      unsigned short u16Packed;
+      unsigned short u16Huffman;
+      unsigned char u8Chars;
+      TRoom PackedRoom;
+      TRoom HuffmanRoom;
+
+      void Symbol(unsigned char u8Symbol)
+      {
+         u16Packed += SymbolBits;
+         u16Huffman += U8CodeLens[u8Symbol];
+         // Shift and Escape take no char, the one after an Escape is Raw
+         if (u8Symbol == Shift || u8Symbol == Escape)
+         {
+            Take(0);
+         }
+         else
+         {
+            Take(u8Symbol >= FirstPair ? 2 : 1);
+         }
+      }
+
+      void Raw(unsigned char u8Char)
+      {
+         u16Packed += RawBits;
+         u16Huffman += RawBits;
+         Take(1);
+      }
+
+      void Take(unsigned char u8Count)
+      {
+         PackedRoom.Update(u16Packed, u8Chars, u8Chars + u8Count);
+         HuffmanRoom.Update(u16Huffman, u8Chars, u8Chars + u8Count);
+         u8Chars += u8Count;
+      }
+
+      // the shortest of the three for the u8Len chars counted
+      eCodec Pick(unsigned char u8Len) const
+      {
+         if (u8Len <= GetCodedLen(Packed, u8Len) - HeaderSize && u8Len <= GetCodedLen(Huffman, u8Len) - HeaderSize)
+         {
+            return Plain;
+         }
+
+         return u16Huffman < u16Packed ? Huffman : Packed;
+      }
+
+      unsigned short GetCodedLen(eCodec Codec, unsigned char u8Len) const
+      {
+         if (Codec == Plain)
+         {
+            return HeaderSize + u8Len;
+         }
+
+         return HeaderSize + ((Codec == Huffman ? u16Huffman : u16Packed) + 7) / 8;
+      }
+   };
+
+   class CBitWriter
+   {
+   public:
+      CBitWriter(unsigned char *p8Out, bool bHuffman)
+          : p8Out(p8Out), bHuffman(bHuffman), u32Acc(0), u8AccBits(0) {}
+
+      void Symbol(unsigned char u8Symbol)
+      {
+         if (bHuffman)
+         {
+            Put(Tables.U16Codes[u8Symbol], U8CodeLens[u8Symbol]);
+         }
+         else
+         {
+            Put(u8Symbol, SymbolBits);
+         }
+      }
+
+      void Raw(unsigned char u8Char) { Put(u8Char, RawBits); }
+
+      // pads with ones, returns the end
+      unsigned char *Flush()
+      {
+         if (u8AccBits)
+         {
+            Put(0xFF >> u8AccBits, 8 - u8AccBits);
+         }
+
+         return p8Out;
+      }
+
+   private:
+      void Put(unsigned short u16Bits, unsigned char u8Count)
+      {
+         u32Acc = (u32Acc << u8Count) | u16Bits;
+         u8AccBits += u8Count;
+         while (u8AccBits >= 8)
+         {
+            u8AccBits -= 8;
+            *p8Out++ = u32Acc >> u8AccBits;
+         }
+      }
+
+      unsigned char *p8Out;
+      bool bHuffman;
+      unsigned int u32Acc;
+      unsigned char u8AccBits;
+   };
+
+   class CBitReader
+   {
+   public:
+      CBitReader(const unsigned char *p8In, unsigned char u8Len)
+          : p8In(p8In), u16Bit(0), u16Bits(u8Len * 8) {}
+
+      unsigned short GetLeft() const { return u16Bits - u16Bit; }
+
+      unsigned char Bit()
+      {
+         auto const u8Bit = p8In[u16Bit >> 3] >> (7 - (u16Bit & 7)) & 1;
+         u16Bit++;
+         return u8Bit;
+      }
+
+      unsigned char Bits(unsigned char u8Count)
+      {
+         unsigned char u8Bits = 0;
+         while (u8Count--)
+         {
+            u8Bits = (u8Bits << 1) | Bit();
+         }
+
+         return u8Bits;
+      }
+
+      // Symbols when the bits run out inside a code
+      unsigned char Huffman()
+      {
+         unsigned short u16Code = 0, u16First = 0;
+         unsigned char u8Index = 0;
+         for (unsigned char u8Len = 1; u8Len <= MaxCodeLen && GetLeft(); u8Len++)
+         {
+            u16Code |= Bit();
+            auto const u8Count = Tables.U8LenCount[u8Len];
+            if (u16Code - u16First < u8Count)
+            {
+               return Tables.U8Sorted[u8Index + u16Code - u16First];
+            }
+
+            u8Index += u8Count;
+            u16First = (u16First + u8Count) << 1;
+            u16Code <<= 1;
+         }
+
+         return Symbols;
+      }
+
+   private:
+      const unsigned char *p8In;
+      unsigned short u16Bit;
+      unsigned short u16Bits;
+   };
+
+   // p8Out may start below C8Text as long as the bytes never catch up
+   // with chars not read yet, returns the coded length
+   inline unsigned char Write(eCodec Codec, const char *C8Text, unsigned char u8Len, unsigned char *p8Out)
+   {
+      p8Out[0] = Codec;
+      if (Codec == Plain)
+      {
+         for (unsigned char i = 0; i < u8Len; i++)
+         {
+            p8Out[HeaderSize + i] = C8Text[i];
+         }
+
+         return HeaderSize + u8Len;
+      }
+
+      CBitWriter Writer(p8Out + HeaderSize, Codec == Huffman);
+      ForEachSymbol(C8Text, u8Len, Writer);
+      return Writer.Flush() - p8Out;
+   }
+
+   // p8Out takes at least u8Len + HeaderSize bytes, returns the coded length
+   inline unsigned char Encode(const char *C8Text, unsigned char u8Len, unsigned char *p8Out)
+   {
+      TBitCounter Counter = {};
+      ForEachSymbol(C8Text, u8Len, Counter);
+      return Write(Counter.Pick(u8Len), C8Text, u8Len, p8Out);
+   }
+
+   // codes the u8Len chars at the start of C8Buff over themselves, C8Buff
+   // holds u8Size >= u8Len + HeaderSize bytes. The text is moved up by
+   // the lead of the code first. A code that needs more room than that,
+   // or that DecodeInPlace couldn't take back in u8Size, goes out plain.
+   // Returns the coded length
+   inline unsigned char EncodeInPlace(char *C8Buff, unsigned char u8Len, unsigned char u8Size)
+   {
+      TBitCounter Counter = {};
+      ForEachSymbol(C8Buff, u8Len, Counter);
+      auto Codec = Counter.Pick(u8Len);
+      auto const &Room = Codec == Huffman ? Counter.HuffmanRoom : Counter.PackedRoom;
+      unsigned char u8Shift = HeaderSize;
+      if (Codec != Plain)
+      {
+         if (HeaderSize + Room.u16Lead + u8Len > u8Size ||
+             Room.u16Trail + Counter.GetCodedLen(Codec, u8Len) > u8Size + HeaderSize)
+         {
+            Codec = Plain;
+         }
+         else
+         {
+            u8Shift += Room.u16Lead;
+         }
+      }
+
+      for (unsigned char i = u8Len; i--;)
+      {
+         C8Buff[u8Shift + i] = C8Buff[i];
+      }
+
+      return Write(Codec, C8Buff + u8Shift, u8Len, (unsigned char *)C8Buff);
+   }
+
+   // text into C8Text, cut at u8Size - 1 and NUL terminated. Returns its
+   // length, 0 for an unknown codec
+   inline unsigned char Decode(const unsigned char *p8In, unsigned char u8Len, char *C8Text,
+                               unsigned char u8Size)
+   {
+      unsigned char u8TextLen = 0;
+      if (!u8Len || !u8Size)
+      {
+         return 0;
+      }
+
+      auto const Codec = p8In[0];
+      CBitReader Reader(p8In + HeaderSize, u8Len - HeaderSize);
+      bool bShift = false;
+      while (u8TextLen + 1 < u8Size)
+      {
+         if (Codec == Plain)
+         {
+            if (HeaderSize + u8TextLen >= u8Len)
+            {
+               break;
+            }
+
+            C8Text[u8TextLen] = p8In[HeaderSize + u8TextLen];
+            u8TextLen++;
+            continue;
+         }
+
+         unsigned char u8Symbol = Symbols;
+         if (Codec == Huffman)
+         {
+            u8Symbol = Reader.Huffman();
+         }
+         else if (Codec == Packed && Reader.GetLeft() >= SymbolBits)
+         {
+            u8Symbol = Reader.Bits(SymbolBits);
+         }
+
+         if (u8Symbol == Symbols || (u8Symbol == Escape && Reader.GetLeft() < RawBits))
+         {
+            break;
+         }
+
+         if (u8Symbol == Shift)
+         {
+            bShift = true;
+            continue;
+         }
+
+         char C8Chars[2] = {0, 0};
+         if (u8Symbol == Escape)
+         {
+            C8Chars[0] = Reader.Bits(RawBits);
+         }
+         else if (u8Symbol >= FirstPair)
+         {
+            C8Chars[0] = C8Pairs[u8Symbol - FirstPair][0];
+            C8Chars[1] = C8Pairs[u8Symbol - FirstPair][1];
+         }
+         else
+         {
+            C8Chars[0] = C8Singles[u8Symbol];
+         }
+
+         if (bShift && C8Chars[0] >= 'a' && C8Chars[0] <= 'z')
+         {
+            C8Chars[0] += 'A' - 'a';
+         }
+
+         bShift = false;
+         for (unsigned char i = 0; i < 2 && C8Chars[i] && u8TextLen + 1 < u8Size; i++)
+         {
+            C8Text[u8TextLen++] = C8Chars[i];
+         }
+      }
+
+      C8Text[u8TextLen] = '\0';
+      return u8TextLen;
+   }
+
+   // the u8Len coded bytes at C8Buff + u8At back to text over C8Buff,
+   // which holds u8Size bytes, as Decode. The bytes are moved to the end
+   // of C8Buff first, EncodeInPlace with this or a smaller u8Size made
+   // sure the chars never catch up with them
+   inline unsigned char DecodeInPlace(char *C8Buff, unsigned char u8Size, unsigned char u8At,
+                                      unsigned char u8Len)
+   {
+      unsigned char const u8To = u8Size - u8Len;
+      for (unsigned char i = u8Len; i--;)
+      {
+         C8Buff[u8To + i] = C8Buff[u8At + i];
+      }
+
+      return Decode((const unsigned char *)C8Buff + u8To, u8Len, C8Buff, u8Size);
+   }
+} // namespace TextCodec
@@ -2,6 +2,7 @@
 #include "manager.hpp"
 #include "registers.hpp"
 #include "hardware/adc.hpp"
+#include "number_format.hpp"
 
 template <
     TUV_K5Display &DisplayBuff,
@@ -30,6 +31,8 @@ public:
          return eScreenRefreshFlag::NoRefresh;
       }
 
+      RadioDriver.InvalidateShadow(); // stock fw has just set up tx
+
       if(bInit)
       {
          bInit = false;
@@ -63,10 +66,15 @@ public:
       //    MicAmp = 0;
       unsigned short U16AdcData[2];
       AdcReadout(U16AdcData, U16AdcData+1);
-      FormatString(S8DebugStr, "in 1: %05i   ", U16AdcData[0]);
-      PrintTextOnScreen(S8DebugStr, 0, 127, 0, 8, 0);
-      FormatString(S8DebugStr, "in 2: %05i   ", U16AdcData[1]);
-      PrintTextOnScreen(S8DebugStr, 0, 127, 2, 8, 0);
+      for (unsigned char i = 0; i < 2; i++)
+      {
+         char *pEnd = NumberFormat::String(S8DebugStr, "in ");
+         *pEnd++ = '1' + i;
+         pEnd = NumberFormat::String(pEnd, ": ");
+         pEnd = NumberFormat::Padded<5>(pEnd, U16AdcData[i]);
+         NumberFormat::String(pEnd, "   ");
+         PrintTextOnScreen(S8DebugStr, 0, 127, i << 1, 8, 0);
+      }
    }
 
    void HandleMicInput()
@@ -2,6 +2,7 @@
 #include "menu.hpp"
 #include "system.hpp"
 #include "keyboard.hpp"
+#include "number_format.hpp"
  
 inline char S8Label[20];
 class CHeater : public IMenuElement
@@ -42,7 +43,7 @@ class CAmRx : public IMenuElement
    public:
    const char *GetLabel() override
    {
-      FormatString(S8Label, "AM RX     %u", u8Mode);
+      NumberFormat::Unsigned(NumberFormat::String(S8Label, "AM RX     "), u8Mode);
       return S8Label;
    }
 
@@ -69,7 +70,7 @@ class CMicVal : public IMenuElement
    public:
    const char *GetLabel() override
    {
-      FormatString(S8Label, "MIC in    %u", BK4819Read(0x64));
+      NumberFormat::Unsigned(NumberFormat::String(S8Label, "MIC in    "), BK4819Read(0x64));
       return S8Label;
    }
 
@@ -87,7 +88,7 @@ class CRssiVal : public IMenuElement
    public:
    const char *GetLabel() override
    {                         
-      FormatString(S8Label, "RSSI     %i", RadioDriver.GetRssi());
+      NumberFormat::Signed(NumberFormat::String(S8Label, "RSSI     "), RadioDriver.GetRssi());
       return S8Label;
    }
 
@@ -3,11 +3,18 @@
 #include "system.hpp"
 #include "keyboard.hpp"
 #include "registers.hpp"
+#include "uv_k5_display.hpp"
 
+// with pMainDisplay set the main screen is flushed in parts, see
+// TUV_K5Display::FlushDirty. Background views are expected to draw through
+// it, views on the stack own the whole screen and usually draw with stock
+// routines, so their refresh pushes everything unless they return
+// MainScreenMarked after marking their spans themselves.
 template <
    unsigned char BackgroundViewPrescaler,
    unsigned char MainViewPrescaler,
-   unsigned char RegisteredViews>
+   unsigned char RegisteredViews,
+   TUV_K5Display *pMainDisplay = nullptr>
 class CViewManager
 {
    static constexpr auto ManagerStartupDelay = 200;
@@ -49,13 +56,24 @@ class CViewManager
          if(!MainViewContext.OriginalFwStatus.b1RadioSpiCommInUse)
             Keyboard.Handle(PollKeyboard());
 
-         u8ScreenRefreshFlag |= 
+         auto const u8MainViewFlag =
             pViewStackTop->HandleMainView(MainViewContext);
+         if constexpr (pMainDisplay != nullptr)
+         {
+            if((u8MainViewFlag & eScreenRefreshFlag::MainScreenMarked) ==
+                  eScreenRefreshFlag::MainScreen)
+               pMainDisplay->MarkAllDirty();
+         }
+
+         u8ScreenRefreshFlag |= u8MainViewFlag;
       }
 
       if(u8ScreenRefreshFlag & eScreenRefreshFlag::MainScreen)
       {
-         FlushFramebufferToScreen();
+         if constexpr (pMainDisplay != nullptr)
+            pMainDisplay->FlushDirty();
+         else
+            FlushFramebufferToScreen();
       }
 
       if(u8ScreenRefreshFlag & eScreenRefreshFlag::StatusBar)
@@ -2,7 +2,10 @@
 #include "system.hpp"
 #include "uv_k5_display.hpp"
 #include "t9.hpp"
+#include "number_format.hpp"
 #include "radio.hpp"
+#include "arq.hpp"
+#include "text_codec.hpp"
 #include "manager.hpp"
 
 template <
@@ -13,6 +16,14 @@ class CMessenger : public IView
 {
 public:
    static constexpr auto MaxCharsInLine = 128 / 8;
+   // side key 1 switches between Fec coded packets, twice the air time
+   // but bit errors get repaired, and plain ones. Both ends have to agree,
+   // the mode is shown in front of the stats line
+   static constexpr unsigned char FecKey = 23;
+   // 8 fragments of 12 bytes, each in its own Packet and acked by the peer
+   using TArq = CArq<12>;
+   // TextCodec falls back to plain text when nothing is gained
+   static constexpr unsigned char MaxTextLen = TArq::MaxMessageLen - TextCodec::HeaderSize;
 
    enum class eState : unsigned char
    {
@@ -25,13 +36,18 @@ public:
 
    CMessenger()
        : T9(S8TxBuff),
+         u8RxTextLen(0),
          bDisplayCleared(true),
          bEnabled(0),
          State(eState::InitRx),
-         u8RxDoneLabelCnt(0xFF){};
+         u8RxDoneLabelCnt(0xFF),
+         u8RxScroll(0),
+         bFec(true){};
 
    eScreenRefreshFlag HandleBackground(TViewContext &Context) override
    {
+      u32Now = Context.u32SystemCounter;
+      RadioDriver.HandleRx();
       if (!FreeToDraw())
       {
          if (!bDisplayCleared)
@@ -56,15 +72,25 @@ public:
          return eScreenRefreshFlag::NoRefresh;
       }
 
+      // the background rate is too slow to rearm rx between the frames
+      // of a burst
+      u32Now = Context.u32SystemCounter;
+      RadioDriver.HandleRx();
+
       ClearDrawingsIfNeeded();
       PrintTxData();
       PrintRxData();
+      PrintStats();
       Display.DrawRectangle(0, (8 * 4) - 6, 127, 24 + 6, false);
 
       if (u8RxDoneLabelCnt < 100)
       {
          u8RxDoneLabelCnt++;
-         PrintTextOnScreen("> RX <", 0, 128, 2, 8, 1);
+         PrintLine("> RX <", 0, 2, true);
+      }
+      else if (Arq.IsBusy())
+      {
+         PrintLine("> TX <", 0, 2, true);
       }
 
       switch (State)
@@ -74,16 +100,23 @@ public:
          InitRxHandler();
          break;
       }
-      case eState::InitTx:
-      {
-         HandleInitTx();
-         break;
-      }
       default:
          break;
       }
 
-      return eScreenRefreshFlag::MainScreen;
+      SendDueFrame();
+      return eScreenRefreshFlag::MainScreenMarked;
+   }
+
+   // stock text is two pages high and bypasses DisplayBuff, so the pages
+   // it covers are marked here. Lines are padded to the full width
+   void PrintLine(const char *C8Text, unsigned char u8X, unsigned char u8Line, bool bCentered = false)
+   {
+      PrintTextOnScreen(C8Text, u8X, 128, u8Line, 8, bCentered);
+      for (unsigned char u8Page = u8Line; u8Page < u8Line + 2 && u8Page < DisplayBuff.Pages; u8Page++)
+      {
+         DisplayBuff.MarkDirty(u8Page, u8X, DisplayBuff.SizeX);
+      }
    }
 
    void ClearDrawingsIfNeeded()
@@ -95,40 +128,100 @@ public:
       }
    }
 
+   // spaces up to a full line, lines are drawn over the previous ones
+   static void PadLine(char *C8Line, char *pEnd)
+   {
+      while (pEnd < C8Line + MaxCharsInLine)
+      {
+         *pEnd++ = ' ';
+      }
+
+      C8Line[MaxCharsInLine] = '\0';
+   }
+
+   // the tail of the text being typed, one line of it fits
    void PrintTxData()
    {
-      char C8PrintBuff[30];
-      FormatString(C8PrintBuff, ">%s", T9.C8WorkingBuff);
-      PrintTextOnScreen(C8PrintBuff, 0, 128, 0, 8, 0);
+      char C8PrintBuff[MaxCharsInLine + 1];
+      auto const u8Len = T9.GetIdx();
+      auto const u8Start = u8Len < MaxCharsInLine ? 0 : u8Len - (MaxCharsInLine - 1);
+      C8PrintBuff[0] = '>';
+      memcpy(C8PrintBuff + 1, S8TxBuff + u8Start, u8Len - u8Start);
+      PadLine(C8PrintBuff, C8PrintBuff + 1 + u8Len - u8Start);
+      PrintLine(C8PrintBuff, 0, 0);
    }
 
+   // two lines of the last message from u8RxScroll, up and down move it
    void PrintRxData()
    {
-      // char *tempRxBuff = S8RxBuff + MaxCharsInLine;
-      // char C8Temp = tempRxBuff[MaxCharsInLine];
-      // S8RxBuff[MaxCharsInLine] = '\0';
-      PrintTextOnScreen(S8RxBuff, 1, 128, 3, 8, 0);
-      // S8RxBuff[MaxCharsInLine] = C8Temp;
-      // PrintTextOnScreen(tempRxBuff, 1, 128, 5, 8, 0);
+      if (!u8RxTextLen)
+      {
+         return;
+      }
+
+      char C8PrintBuff[MaxCharsInLine + 1];
+      const char *pText = S8RxText + u8RxScroll * MaxCharsInLine;
+      for (unsigned char u8Line = 3; u8Line <= 5; u8Line += 2)
+      {
+         auto const u8Len = strnlen(pText, MaxCharsInLine);
+         memcpy(C8PrintBuff, pText, u8Len);
+         PadLine(C8PrintBuff, C8PrintBuff + u8Len);
+         PrintLine(C8PrintBuff, 1, u8Line);
+         pText += u8Len;
+      }
    }
 
-   void HandleInitTx()
+   // packet coding, then delivered/sent, failed, repeated frames and the
+   // last ack latency
+   void PrintStats()
    {
-      static unsigned char u8TxDelay = 0;
-      if (u8TxDelay++ >= 1)
+      // five counters may run past a line, it is cut
+      char C8PrintBuff[40];
+      char *pEnd = NumberFormat::String(C8PrintBuff, bFec ? "fec" : "raw");
+      auto const &Stats = Arq.GetStats();
+      if (!Stats.u16Sent)
       {
-         u8TxDelay = 0;
-         RadioDriver.SendSyncAirCopyMode72((unsigned char *)S8TxBuff);
-         State = eState::InitRx;
+         PadLine(C8PrintBuff, pEnd);
+         PrintLine(C8PrintBuff, 0, 7);
+         return;
+      }
+
+      pEnd = NumberFormat::Unsigned(NumberFormat::String(pEnd, " "), Stats.u16Delivered);
+      pEnd = NumberFormat::Unsigned(NumberFormat::String(pEnd, "/"), Stats.u16Sent);
+      pEnd = NumberFormat::Unsigned(NumberFormat::String(pEnd, " F"), Stats.u16Failed);
+      pEnd = NumberFormat::Unsigned(NumberFormat::String(pEnd, " R"), Stats.u16Repeats);
+      pEnd = NumberFormat::Unsigned(NumberFormat::String(pEnd, " "), Stats.u16LastLatency * 10);
+      pEnd = NumberFormat::String(pEnd, "ms");
+      PadLine(C8PrintBuff, pEnd);
+      PrintLine(C8PrintBuff, 0, 7);
+   }
+
+   // one frame per call, rx is armed again before the next one
+   void SendDueFrame()
+   {
+      unsigned char u8Seq;
+      auto const u8Len = Arq.Poll(u32Now, U8TxFrame, u8Seq);
+      if (!u8Len)
+      {
+         return;
       }
 
-      PrintTextOnScreen("> TX <", 0, 128, 2, 8, 1);
+      RadioDriver.SendSyncPacket(Packet::eKind::Arq, u8Seq, U8TxFrame, u8Len, bFec);
+      State = eState::InitRx;
    }
+
+   // u8DataLen is the payload length, U8RxFrame holds the whole frame
    void RxDoneHandler(unsigned char u8DataLen, bool bCrcOk)
    {
-      bEnabled = true;
       State = eState::InitRx;
-      u8RxDoneLabelCnt = 0;
+      if (bCrcOk && Arq.OnFrame(U8RxFrame[Packet::SeqIdx], U8RxFrame + Packet::HeaderSize, u8DataLen, u32Now))
+      {
+         u8RxTextLen = TextCodec::Decode((const unsigned char *)Arq.GetRxMessage(), Arq.GetRxLen(),
+                                         S8RxText, sizeof(S8RxText));
+         bEnabled = true;
+         u8RxDoneLabelCnt = 0;
+         u8RxScroll = 0;
+      }
    }
 
 private:
@@ -153,24 +246,44 @@ private:
 
    void InitRxHandler()
    {
-      RadioDriver.RecieveAsyncAirCopyMode((unsigned char *)S8RxBuff, sizeof(S8RxBuff), Radio::CallbackRxDoneType(this, &CMessenger::RxDoneHandler));
+      RadioDriver.RecieveAsyncPacket(RxRing, U8RxFrame, sizeof(U8RxFrame), Radio::CallbackRxDoneType(this, &CMessenger::RxDoneHandler), Packet::eKind::Arq, bFec);
       State = eState::WaitForRx;
    }
 
    void ClearDrawings()
    {
       memset(gDisplayBuffer, 0, (DisplayBuff.SizeX / 8) * DisplayBuff.SizeY);
+      DisplayBuff.MarkAllDirty();
    }
 
-   void HandlePressedButton(unsigned char u8Button) override
+   void HandlePressedButton(TViewContext &Context, unsigned char u8Button) override
    {
    }
 
-   void HandleReleasedButton(unsigned char u8Button) override
+   void HandleReleasedButton(TViewContext &Context, unsigned char u8Button) override
    {
       if (u8Button == 10)
       {
-         State = eState::InitTx;
+         if (!Arq.IsBusy())
+         {
+            auto const u8Len = TextCodec::Encode(S8TxBuff, T9.GetIdx(), U8TxMessage);
+            Arq.Send(U8TxMessage, u8Len, Context.u32SystemCounter);
+         }
+
+         return;
+      }
+
+      if (u8Button == 11 || u8Button == 12)
+      {
+         ScrollRx(u8Button == 12);
+         return;
+      }
+
+      // rx is armed again in the new coding
+      if (u8Button == FecKey)
+      {
+         bFec = !bFec;
+         State = eState::InitRx;
          return;
       }
 
@@ -180,16 +293,48 @@ private:
          return;
       }
 
+      if (T9.GetIdx() >= MaxTextLen && u8Button != 13)
+      {
+         return;
+      }
+
       T9.ProcessButton(u8Button);
    }
 
-   char S8TxBuff[50];
-   char S8RxBuff[72];
+   void ScrollRx(bool bDown)
+   {
+      auto const u8Lines = (u8RxTextLen + MaxCharsInLine - 1) / MaxCharsInLine;
+      if (bDown && u8RxScroll + 2 < u8Lines)
+      {
+         u8RxScroll++;
+      }
+      else if (!bDown && u8RxScroll)
+      {
+         u8RxScroll--;
+      }
+   }
+
+   // T9 terminates the text
+   char S8TxBuff[MaxTextLen + 1];
+   // coded text, sent from here until the peer acked all of it
+   unsigned char U8TxMessage[TArq::MaxMessageLen];
+   unsigned char U8TxFrame[TArq::MaxFrameLen];
+   unsigned char U8RxFrame[24];
+   // Fec decoding in place needs the longer buffer
+   static_assert(Fec::GetMaxFrameLen(sizeof(U8RxFrame)) >= Packet::GetFrameLen(TArq::MaxFrameLen),
+                 "rx buffer too short for an Arq frame");
+   Radio::TRxRing RxRing;
    CT9Decoder<sizeof(S8TxBuff)> T9;
+   TArq Arq;
+   char S8RxText[MaxTextLen + 1];
+   unsigned char u8RxTextLen;
+   unsigned int u32Now;
 
    bool bDisplayCleared;
    unsigned char u8LastBtnPressed;
    bool bEnabled;
    eState State;
    unsigned char u8RxDoneLabelCnt;
+   unsigned char u8RxScroll;
+   bool bFec;
 };
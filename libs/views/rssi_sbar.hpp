@@ -125,7 +125,7 @@ public:
          if (!bIsCleared)
          {
             bIsCleared = true;
-            memset(pDData, 0, DisplayBuff.SizeX);
+            ClearSbarLine();
             if (!Context.OriginalFwStatus.b1MenuDrawed)
             {
                return eScreenRefreshFlag::MainScreen;
@@ -169,6 +169,7 @@ public:
    void ClearSbarLine()
    {
       memset(pDData, 0, DisplayBuff.SizeX);
+      DisplayBuff.MarkDirty(3, 0, DisplayBuff.SizeX);
    }
 
    void PrintNumber(short s16Number)
@@ -179,7 +180,7 @@ public:
          Display.PrintCharacter(' ');
       }
 
-      Display.PrintFixedDigitsNumber2(s16Number, 0, 3);
+      Display.PrintFixed<0, 3>(s16Number);
    }
 
    void PrintSValue(unsigned char u8SValue)
@@ -242,10 +243,10 @@ public:
 
       memset(gStatusBarData + VoltageOffset, 0, 4 * 5);
       DisplayStatusBar.SetCoursor(0, VoltageOffset);
-      DisplayStatusBar.PrintFixedDigitsNumber2(u16Voltage, 2, 1);
+      DisplayStatusBar.PrintFixed<2, 1>(u16Voltage);
       memset(gStatusBarData + VoltageOffset + 7 + 1, 0b1100000, 2); // dot
       DisplayStatusBar.SetCoursor(0, VoltageOffset + 7 + 4);
-      DisplayStatusBar.PrintFixedDigitsNumber2(u16Voltage, 0, 2);
+      DisplayStatusBar.PrintFixed<0, 2>(u16Voltage);
       memcpy(gStatusBarData + VoltageOffset + 4 * 6 + 2, gSmallLeters + 128 * 2 + 102, 5); // V character
    }
 };
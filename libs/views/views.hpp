@@ -5,6 +5,9 @@ enum eScreenRefreshFlag : unsigned char
    NoRefresh = 0,
    StatusBar = 0b01, 
    MainScreen = 0b10, 
+   // main screen drawn, the view marked what it changed on the tracked
+   // display itself, see CViewManager
+   MainScreenMarked = 0b110,
 };
 
 class CViewStack;
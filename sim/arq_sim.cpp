@@ -0,0 +1,287 @@
+#include "sim.hpp"
+#include "arq.hpp"
+#include "fec.hpp"
+#include "packet.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// two messenger CArq ends on a half duplex channel that loses frames.
+// Time runs in SysTicks, a frame blocks its sender for the SendSyncPacket
+// air time of a Fec coded packet (its tick counter stands still meanwhile,
+// as in the SysTick handler) and ends are polled at the CViewManager main
+// view rate. A sends messages of random length up to the ARQ maximum, B
+// answers every fourth one, overlapping frames are both lost. Fails when a
+// message arrives twice or corrupted, is acked without having arrived, or
+// goes missing on a channel without losses
+// usage: arq_sim [messages]
+
+namespace
+{
+   using TArq = CArq<12>;
+
+   static constexpr unsigned char PollPrescaler = 2;
+   // ticks until a receiver that handled a frame listens again
+   static constexpr unsigned char RearmTicks = 4;
+   // the two 20ms waits of SendSyncPacket
+   static constexpr unsigned char TxSetupTicks = 4;
+   static constexpr unsigned short MaxMessages = 1000;
+
+   struct TMessage
+   {
+      unsigned char U8Text[TArq::MaxMessageLen];
+      unsigned char u8Len;
+      unsigned char u8Arrived;
+   };
+
+   struct TEnd
+   {
+      TArq Arq;
+      TMessage *pMessages;
+      unsigned short u16ToSend;
+      unsigned short u16Next;
+      unsigned int u32Clock;
+      unsigned int u32TxUntil;
+      unsigned int u32OnAirFrom;
+      unsigned int u32RxReadyAt;
+      unsigned int u32SendAt;
+      // the user types the next one this long after the last went out
+      unsigned short u16PauseMin;
+      unsigned short u16PauseSpread;
+      bool bSending;
+      unsigned int u32SentAt;
+      unsigned short u16Delivered;
+      // frame on air
+      unsigned char U8Frame[TArq::MaxFrameLen];
+      unsigned char u8FrameLen;
+      unsigned char u8FrameSeq;
+      bool bCollided;
+   };
+
+   struct TResult
+   {
+      unsigned int u32Messages;
+      unsigned int u32Arrived;
+      unsigned int u32Delivered;
+      unsigned int u32Failed;
+      unsigned int u32Frames;
+      unsigned int u32Repeats;
+      unsigned int u32Duplicates;
+      unsigned int u32Errors;
+      unsigned int u32LatencySum;
+      unsigned int u32Ticks;
+   };
+
+   TMessage MessagesA[MaxMessages], MessagesB[MaxMessages];
+   unsigned int u32Seed = 0x12345678;
+
+   unsigned int Random()
+   {
+      u32Seed ^= u32Seed << 13;
+      u32Seed ^= u32Seed >> 17;
+      u32Seed ^= u32Seed << 5;
+      return u32Seed;
+   }
+
+   unsigned int GetAirTicks(unsigned char u8FrameLen)
+   {
+      auto const u32Bytes =
+          Sim::CBK4819Model::FskPreambleBytes + Fec::GetAirLen(Packet::GetFrameLen(u8FrameLen));
+      return (u32Bytes * Sim::CBK4819Model::FskByteCycles + Sim::TickCycles - 1) / Sim::TickCycles;
+   }
+
+   // "#<number> " and random letters, the number tells which message came
+   void MakeMessage(TMessage &Message, unsigned short u16Number)
+   {
+      Message.u8Len = 1 + Random() % TArq::MaxMessageLen;
+      Message.u8Arrived = 0;
+      auto const u8Prefix = snprintf((char *)Message.U8Text, sizeof(Message.U8Text), "#%u ", u16Number);
+      for (unsigned char i = u8Prefix; i < Message.u8Len; i++)
+      {
+         Message.U8Text[i] = 'a' + Random() % 26;
+      }
+
+      if (Message.u8Len < u8Prefix)
+      {
+         Message.u8Len = u8Prefix;
+      }
+   }
+
+   void Deliver(TEnd &From, TEnd &To, unsigned int u32Tick, unsigned int u32LossPpm, TResult &Result)
+   {
+      auto const u8FrameLen = From.u8FrameLen;
+      From.u8FrameLen = 0;
+      // a receiver setting up its own transmission is deaf too
+      if (From.bCollided || To.u8FrameLen || From.u32OnAirFrom < To.u32RxReadyAt ||
+          Random() % 1000000 < u32LossPpm)
+      {
+         return;
+      }
+
+      To.u32RxReadyAt = u32Tick + RearmTicks;
+      if (!To.Arq.OnFrame(From.u8FrameSeq, From.U8Frame, u8FrameLen, To.u32Clock))
+      {
+         return;
+      }
+
+      auto const *pText = To.Arq.GetRxMessage();
+      auto const u16Number = atoi(pText + 1);
+      auto &Message = From.pMessages[u16Number < From.u16Next ? u16Number : 0];
+      bool const bIntact = pText[0] == '#' && u16Number < From.u16Next &&
+                           To.Arq.GetRxLen() == Message.u8Len &&
+                           !memcmp(pText, Message.U8Text, Message.u8Len);
+      Result.u32Errors += !bIntact || Message.u8Arrived;
+      Message.u8Arrived++;
+      Result.u32Arrived++;
+   }
+
+   // the message an end was sending is through, acked means it arrived
+   void CheckAcked(TEnd &End, unsigned int u32Tick, TResult &Result)
+   {
+      auto const &Stats = End.Arq.GetStats();
+      if (Stats.u16Delivered != End.u16Delivered)
+      {
+         End.u16Delivered = Stats.u16Delivered;
+         Result.u32Errors += !End.pMessages[End.u16Next - 1].u8Arrived;
+         // wall time, u16LastLatency leaves out the sender's own air time
+         Result.u32LatencySum += u32Tick - End.u32SentAt;
+      }
+   }
+
+   void Step(TEnd &End, TEnd &Peer, unsigned int u32Tick, TResult &Result)
+   {
+      if (u32Tick < End.u32TxUntil)
+      {
+         return;
+      }
+
+      End.u32Clock++;
+      if (End.bSending && !End.Arq.IsBusy())
+      {
+         End.bSending = false;
+         CheckAcked(End, u32Tick, Result);
+         End.u32SendAt = u32Tick + End.u16PauseMin + Random() % End.u16PauseSpread;
+      }
+
+      if (!End.Arq.IsBusy() && End.u16Next < End.u16ToSend && u32Tick >= End.u32SendAt)
+      {
+         auto &Message = End.pMessages[End.u16Next];
+         MakeMessage(Message, End.u16Next);
+         End.u16Next++;
+         End.u32SentAt = u32Tick;
+         End.bSending = End.Arq.Send(Message.U8Text, Message.u8Len, End.u32Clock);
+      }
+
+      if (u32Tick % PollPrescaler)
+      {
+         return;
+      }
+
+      unsigned char u8Seq;
+      auto const u8Len = End.Arq.Poll(End.u32Clock, End.U8Frame, u8Seq);
+      if (!u8Len)
+      {
+         return;
+      }
+
+      End.u8FrameLen = u8Len;
+      End.u8FrameSeq = u8Seq;
+      End.u32OnAirFrom = u32Tick + TxSetupTicks;
+      End.u32TxUntil = End.u32OnAirFrom + GetAirTicks(u8Len);
+      End.bCollided = false;
+      // the peer's frame in flight is lost, and so is this one
+      if (Peer.u8FrameLen && Peer.u32TxUntil > End.u32OnAirFrom)
+      {
+         Peer.bCollided = End.bCollided = true;
+      }
+   }
+
+   TResult Run(unsigned short u16Messages, unsigned int u32LossPpm)
+   {
+      static TEnd A, B;
+      A = {};
+      B = {};
+      // radios powered up at different times
+      A.u32Clock = Random() % 10000;
+      B.u32Clock = Random() % 10000;
+      A.pMessages = MessagesA;
+      A.u16ToSend = u16Messages;
+      A.u16PauseSpread = 50;
+      B.pMessages = MessagesB;
+      B.u16ToSend = u16Messages / 4;
+      B.u16PauseMin = 100;
+      B.u16PauseSpread = 200;
+
+      TResult Result = {};
+      unsigned int u32Tick = 0;
+      for (; A.u16Next < A.u16ToSend || B.u16Next < B.u16ToSend || A.bSending || B.bSending ||
+             A.u8FrameLen || B.u8FrameLen;
+           u32Tick++)
+      {
+         if (A.u8FrameLen && u32Tick == A.u32TxUntil)
+         {
+            Deliver(A, B, u32Tick, u32LossPpm, Result);
+         }
+
+         if (B.u8FrameLen && u32Tick == B.u32TxUntil)
+         {
+            Deliver(B, A, u32Tick, u32LossPpm, Result);
+         }
+
+         Step(A, B, u32Tick, Result);
+         Step(B, A, u32Tick, Result);
+      }
+
+      TEnd *const pEnds[] = {&A, &B};
+      for (auto const *pEnd : pEnds)
+      {
+         auto const &Stats = pEnd->Arq.GetStats();
+         Result.u32Messages += Stats.u16Sent;
+         Result.u32Delivered += Stats.u16Delivered;
+         Result.u32Failed += Stats.u16Failed;
+         Result.u32Frames += Stats.u16Frames;
+         Result.u32Repeats += Stats.u16Repeats;
+         Result.u32Duplicates += Stats.u16Duplicates;
+      }
+
+      Result.u32Ticks = u32Tick;
+      return Result;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   unsigned int u32Messages = argc > 1 ? atoi(argv[1]) : 200;
+   if (!u32Messages)
+   {
+      return 0;
+   }
+
+   if (u32Messages > MaxMessages)
+   {
+      u32Messages = MaxMessages;
+   }
+
+   static constexpr unsigned int LossPpm[] = {0, 50000, 100000, 200000, 300000, 500000};
+   bool bFailed = false;
+
+   printf("%u byte messages max, %u byte fragments, %u ms ack timeout\n", TArq::MaxMessageLen,
+          TArq::MaxFrameLen - TArq::ControlSize, TArq::AckTimeout * 10);
+   printf("frame loss  arrived  acked  failed  frames/msg  repeats  dups  ack latency  errors\n");
+   for (auto const u32Loss : LossPpm)
+   {
+      auto const Result = Run(u32Messages, u32Loss);
+      printf("%9.0f%% %7.1f%% %5.1f%% %7u %11.2f %8u %5u %9.0f ms %7u\n", u32Loss / 10000.0,
+             100.0 * Result.u32Arrived / Result.u32Messages,
+             100.0 * Result.u32Delivered / Result.u32Messages, Result.u32Failed,
+             (double)Result.u32Frames / Result.u32Messages, Result.u32Repeats,
+             Result.u32Duplicates,
+             Result.u32Delivered ? 10.0 * Result.u32LatencySum / Result.u32Delivered : 0.0,
+             Result.u32Errors);
+      bFailed |= Result.u32Errors != 0;
+      bFailed |= !u32Loss && Result.u32Arrived != Result.u32Messages;
+   }
+
+   printf("%s\n", bFailed ? "FAILED" : "ok");
+   return bFailed;
+}
@@ -0,0 +1,237 @@
+#include "sim.hpp"
+#include <cstring>
+
+using namespace Sim;
+
+CBK4819Model Sim::BK4819;
+
+void CBK4819Model::Reset(unsigned int u32Frequency)
+{
+   memset(U16Regs, 0, sizeof(U16Regs));
+   U16Regs[0x30] = 0xBFF1; // rx chain enabled
+   U16Regs[0x38] = u32Frequency & 0xFFFF;
+   U16Regs[0x39] = (u32Frequency >> 16) & 0xFFFF;
+   U16Regs[0x47] = 0x6040;
+   pCarriers = nullptr;
+   u8CarriersCnt = 0;
+   u64SettleStart = 0;
+   u32Lfsr = 0xACE1;
+   u8TxFifoLen = 0;
+   u16TxAirLen = 0;
+   u64TxDone = 0;
+   p8RxAir = nullptr;
+   u16RxAirLen = 0;
+   bRxActive = false;
+}
+
+unsigned int CBK4819Model::GetFrequency() const
+{
+   return (U16Regs[0x39] << 16) | U16Regs[0x38];
+}
+
+unsigned short CBK4819Model::Read(unsigned char u8Address)
+{
+   u8Address &= RegistersCnt - 1;
+   switch (u8Address)
+   {
+   case 0x67:
+      return GetRssiReg();
+
+   case 0x02:
+      return GetFskIrq();
+
+   case 0x0C: // bit 0 irq request indicator
+      return (U16Regs[0x0C] & ~1) | !!GetFskIrq();
+
+   case 0x5F:
+   {
+      if (u8RxWordsRead >= GetRxDelivered() / 2)
+      {
+         return 0;
+      }
+
+      auto const u16Idx = 2 * u8RxWordsRead++;
+      return GetRxAirByte(u16Idx) | (GetRxAirByte(u16Idx + 1) << 8);
+   }
+
+   default:
+      return U16Regs[u8Address];
+   }
+}
+
+void CBK4819Model::Write(unsigned char u8Address, unsigned short u16Data)
+{
+   u8Address &= RegistersCnt - 1;
+   auto const u16Old = U16Regs[u8Address];
+   U16Regs[u8Address] = u16Data;
+
+   switch (u8Address)
+   {
+   case 0x30: // rx dsp (bit 0) rising edge restarts rssi measurement
+      if ((u16Data & 1) && !(u16Old & 1))
+      {
+         u64SettleStart = GetStats().u64Cycles;
+      }
+      break;
+
+   case 0x38:
+   case 0x39:
+      if (u16Data != u16Old)
+      {
+         u64SettleStart = GetStats().u64Cycles;
+      }
+      break;
+
+   case 0x02: // clears latched flags, rx ones follow the fifo
+      if (u64TxDone && GetStats().u64Cycles >= u64TxDone)
+      {
+         u64TxDone = 0;
+      }
+      break;
+
+   case 0x58:
+      bRxActive &= u16Data & 1;
+      break;
+
+   case 0x59:
+      if (u16Data & (1 << 15))
+      {
+         u8TxFifoLen = 0;
+      }
+
+      if ((u16Data & (1 << 14)) || !(u16Data & (1 << 12)))
+      {
+         bRxActive = false;
+      }
+
+      if ((u16Data & (1 << 11)) && !(u16Old & (1 << 11)))
+      {
+         u16TxAirLen = GetFskLen();
+         for (unsigned short i = 0; i < u16TxAirLen; i++)
+         {
+            auto const u16Word = i / 2 < u8TxFifoLen ? U16TxFifo[i / 2] : 0;
+            U8TxAir[i] = u16Word >> (8 * (i & 1));
+         }
+
+         u64TxDone = GetStats().u64Cycles +
+                     (unsigned long long)(FskPreambleBytes + u16TxAirLen) * FskByteCycles;
+      }
+      break;
+
+   case 0x5F:
+      if (u8TxFifoLen < sizeof(U16TxFifo) / sizeof(*U16TxFifo))
+      {
+         U16TxFifo[u8TxFifoLen++] = u16Data;
+      }
+      break;
+
+   default:
+      break;
+   }
+}
+
+signed short CBK4819Model::GetTargetDbm() const
+{
+   signed short s16Dbm = NoiseFloorDbm;
+   auto const u32Frequency = GetFrequency();
+   for (unsigned char i = 0; i < u8CarriersCnt; i++)
+   {
+      auto const &Carrier = pCarriers[i];
+      unsigned int u32Distance = u32Frequency > Carrier.u32Frequency
+                                     ? u32Frequency - Carrier.u32Frequency
+                                     : Carrier.u32Frequency - u32Frequency;
+
+      signed int s32Dbm = Carrier.s16Dbm;
+      if (u32Distance > Carrier.u32HalfWidth)
+      {
+         // ~20dB per channel width outside of the occupied band
+         s32Dbm -= (20 * (u32Distance - Carrier.u32HalfWidth)) /
+                   (Carrier.u32HalfWidth ? Carrier.u32HalfWidth : 1);
+      }
+
+      if (s32Dbm > s16Dbm)
+      {
+         s16Dbm = s32Dbm;
+      }
+   }
+
+   return s16Dbm;
+}
+
+unsigned short CBK4819Model::GetRssiReg()
+{
+   if (!(U16Regs[0x30] & 1))
+   {
+      return 0;
+   }
+
+   // rssi filter output rises from the noise floor while settling
+   signed int s32HalfDb = (GetTargetDbm() + 160) * 2;
+   signed int s32FloorHalfDb = (NoiseFloorDbm + 160) * 2;
+   auto const u64Elapsed = GetStats().u64Cycles - u64SettleStart;
+   auto const u64Settle = (unsigned long long)RssiSettleUs * CyclesPerUs;
+   if (u64Elapsed < u64Settle)
+   {
+      s32HalfDb = s32FloorHalfDb +
+                  (signed int)(((s32HalfDb - s32FloorHalfDb) * (signed long long)u64Elapsed) /
+                               (signed long long)u64Settle);
+   }
+
+   // +-1dB of deterministic noise
+   u32Lfsr = (u32Lfsr >> 1) ^ (-(u32Lfsr & 1u) & 0xB400u);
+   s32HalfDb += (signed int)(u32Lfsr % 5) - 2;
+
+   if (s32HalfDb < 0)
+   {
+      s32HalfDb = 0;
+   }
+
+   return s32HalfDb & 0x1FF;
+}
+
+void CBK4819Model::StartRxFrame(const unsigned char *p8Air, unsigned short u16Len)
+{
+   p8RxAir = p8Air;
+   u16RxAirLen = u16Len;
+   u64RxStart = GetStats().u64Cycles + (unsigned long long)FskPreambleBytes * FskByteCycles;
+   u8RxWordsRead = 0;
+   bRxActive = (U16Regs[0x58] & 1) && (U16Regs[0x59] & (1 << 12));
+}
+
+unsigned short CBK4819Model::GetRxDelivered() const
+{
+   auto const u64Now = GetStats().u64Cycles;
+   if (!bRxActive || u64Now < u64RxStart)
+   {
+      return 0;
+   }
+
+   auto const u64Bytes = (u64Now - u64RxStart) / FskByteCycles;
+   return u64Bytes < GetFskLen() ? u64Bytes : GetFskLen();
+}
+
+unsigned short CBK4819Model::GetFskIrq() const
+{
+   unsigned short u16Irq = 0;
+   if (u64TxDone && GetStats().u64Cycles >= u64TxDone)
+   {
+      u16Irq |= 1 << 15;
+   }
+
+   if (bRxActive)
+   {
+      auto const u16Delivered = GetRxDelivered();
+      unsigned char const u8Threshold = U16Regs[0x5E] & 0b111;
+      if (u16Delivered / 2 - u8RxWordsRead >= (u8Threshold ? u8Threshold : 1))
+      {
+         u16Irq |= 1 << 12;
+      }
+
+      if (u16Delivered == GetFskLen())
+      {
+         u16Irq |= 1 << 13;
+      }
+   }
+
+   return u16Irq;
+}
@@ -0,0 +1,295 @@
+#include "text_codec.hpp"
+#include "arq.hpp"
+#include "fec.hpp"
+#include "packet.hpp"
+#include "sim.hpp"
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// TextCodec over a corpus of short English and Polish messages as typed
+// with T9, none of them from the text the Huffman lengths came from.
+// Prints bytes per message plain, packed, Huffman and as picked, the air
+// time of a Fec coded packet and of views messenger fragments plain vs
+// coded, and host cycles per encode / decode. Also codes the corpus and
+// random T9 texts in place as src/messenger does, in its 50 byte tx
+// buffer and in one just a header longer than the text, and decodes them
+// back there and from a received frame. Fails if a message doesn't come back as it was, or
+// decoding random bytes writes past the buffer
+// usage: codec_bench
+
+namespace
+{
+   const char *const C8Corpus[] = {
+       "on my way, be there in 15 min",
+       "the repeater is down again, try simplex on 145.500",
+       "where did you park? i can't see the car",
+       "All good, we reached the summit at noon!",
+       "battery at 20%, switching off until 18:00",
+       "can you bring some extra batteries and a map?",
+       "QSL, 59 here. 73 de SP5XYZ",
+       "dinner is ready, come home",
+       "lost the trail near the lake, heading east",
+       "I hear you loud and clear",
+       "storm coming from the west, take shelter",
+       "the kids are with me, meet at the entrance",
+       "are you still on the same channel?",
+       "Please call back when you get this",
+       "I'm at the hut, door is open",
+       "test 1 2 3",
+       "jestem przy wejsciu, gdzie jestes?",
+       "za godzine bedziemy w schronisku",
+       "Dobra robota, sygnal jest czysty",
+       "zgubilismy szlak, idziemy na wschod",
+       "czy ktos slyszy? prosze o odpowiedz",
+       "bateria 20%, wylaczam do 18:00",
+       "kolacja gotowa, wracaj do domu",
+       "burza nadchodzi, szukajcie schronienia",
+       "Przekaznik nie dziala, sprobuj 145.500",
+       "wszystko w porzadku, jestesmy na szczycie",
+       "nie widze samochodu, gdzie zaparkowales?",
+       "Tomek i Ania sa ze mna",
+       "spotkanie o 7 rano przy moscie",
+       "dzieki, do uslyszenia",
+       "ok",
+       "?",
+       "73",
+       "CQ CQ de SQ9ABC",
+       "https://example.com/a#b$c",
+       "Zolw je salate, a jez je jablko. Tak jest!",
+   };
+
+   static constexpr unsigned char Messages = sizeof(C8Corpus) / sizeof(*C8Corpus);
+   static constexpr unsigned int Iterations = 2000;
+   using TArq = CArq<12>;
+   // S8TxBuff of src/messenger, 49 chars and the TextCodec header
+   static constexpr unsigned char MessengerTxSize = 50;
+
+   unsigned long long Now()
+   {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+#endif
+   }
+
+   // a single Fec coded Packet with u16Payload bytes
+   unsigned int GetPacketAirBytes(unsigned short u16Payload)
+   {
+      return Sim::CBK4819Model::FskPreambleBytes + Fec::GetAirLen(Packet::GetFrameLen(u16Payload));
+   }
+
+   // CArq fragments of the views messenger, acks left out
+   unsigned int GetArqAirBytes(unsigned short u16Message)
+   {
+      unsigned int u32Air = 0;
+      for (unsigned short u16Offset = 0; u16Offset < u16Message; u16Offset += TArq::MaxFrameLen - TArq::ControlSize)
+      {
+         auto const u16Fragment = u16Message - u16Offset < TArq::MaxFrameLen - TArq::ControlSize
+                                      ? u16Message - u16Offset
+                                      : TArq::MaxFrameLen - TArq::ControlSize;
+         u32Air += GetPacketAirBytes(TArq::ControlSize + u16Fragment);
+      }
+
+      return u32Air;
+   }
+
+   // EncodeInPlace of u8Len chars in a u8Size buffer, back with
+   // DecodeInPlace there and behind a Packet header in a 72 byte rx
+   // buffer. Returns the coded length, 0 when the text didn't come back
+   unsigned char CheckInPlace(const char *C8Message, unsigned char u8Len, unsigned char u8Size)
+   {
+      static constexpr unsigned char Guard = 8;
+      char C8Buff[TArq::MaxMessageLen + TextCodec::HeaderSize + Guard];
+      char C8Rx[72 + Guard];
+      memset(C8Buff, 0x55, sizeof(C8Buff));
+      memset(C8Rx, 0x55, sizeof(C8Rx));
+      memcpy(C8Buff, C8Message, u8Len);
+      auto const u8Coded = TextCodec::EncodeInPlace(C8Buff, u8Len, u8Size);
+      memcpy(C8Rx + Packet::HeaderSize, C8Buff, u8Coded);
+      bool bOk = u8Coded <= u8Size &&
+                 TextCodec::DecodeInPlace(C8Buff, u8Size, 0, u8Coded) == u8Len &&
+                 !memcmp(C8Buff, C8Message, u8Len) && !C8Buff[u8Len] &&
+                 TextCodec::DecodeInPlace(C8Rx, 72, Packet::HeaderSize, u8Coded) == u8Len &&
+                 !memcmp(C8Rx, C8Message, u8Len);
+      for (unsigned char i = 0; i < Guard; i++)
+      {
+         bOk = bOk && C8Buff[u8Size + i] == 0x55 && C8Rx[72 + i] == 0x55;
+      }
+
+      return bOk ? u8Coded : 0;
+   }
+
+   // random texts of what T9 types, some with chars only Escape codes
+   bool CheckRandomInPlace()
+   {
+      static constexpr char C8Keys[] = " .,'!?/#$abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+      unsigned int u32Seed = 0x9E3779B9;
+      char C8Text[MessengerTxSize];
+      for (unsigned int u32Run = 0; u32Run < 100000; u32Run++)
+      {
+         u32Seed = u32Seed * 1664525 + 1013904223;
+         auto const u8Len = (u32Seed >> 8) % sizeof(C8Text);
+         // mostly lower case and spaces, runs of capitals or escapes now and then
+         auto const u8Mode = u32Seed >> 28;
+         for (unsigned char i = 0; i < u8Len; i++)
+         {
+            u32Seed = u32Seed * 1664525 + 1013904223;
+            auto const u8Pick = u32Seed >> 24;
+            if (u8Mode == 0)
+            {
+               C8Text[i] = 'A' + u8Pick % 26;
+            }
+            else if (u8Mode == 1)
+            {
+               C8Text[i] = 1 + u8Pick % 255;
+            }
+            else if (u8Pick < 64)
+            {
+               C8Text[i] = ' ';
+            }
+            else
+            {
+               C8Text[i] = C8Keys[u8Pick % (sizeof(C8Keys) - 1)];
+            }
+         }
+
+         if (!CheckInPlace(C8Text, u8Len, MessengerTxSize) ||
+             !CheckInPlace(C8Text, u8Len, u8Len + TextCodec::HeaderSize))
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   bool CheckRandomInput()
+   {
+      unsigned int u32Seed = 0x12345678;
+      unsigned char U8In[64];
+      char C8Text[40];
+      for (unsigned int u32Run = 0; u32Run < 100000; u32Run++)
+      {
+         for (auto &u8Byte : U8In)
+         {
+            u32Seed = u32Seed * 1664525 + 1013904223;
+            u8Byte = u32Seed >> 24;
+         }
+
+         U8In[0] %= 3;
+         auto const u8Len = 1 + u32Seed % sizeof(U8In);
+         auto const u8Size = 1 + (u32Seed >> 8) % (sizeof(C8Text) - 1);
+         C8Text[u8Size] = 0x55;
+         auto const u8TextLen = TextCodec::Decode(U8In, u8Len, C8Text, u8Size);
+         if (u8TextLen >= u8Size || C8Text[u8TextLen] || (unsigned char)C8Text[u8Size] != 0x55)
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+}
+
+int main()
+{
+   unsigned int u32Plain = 0, u32Packed = 0, u32Huffman = 0, u32Coded = 0, u32InPlace = 0;
+   unsigned int u32PacketPlain = 0, u32PacketCoded = 0, u32ArqPlain = 0, u32ArqCoded = 0;
+   unsigned int U32Picked[3] = {};
+   unsigned long long u64EncodeCycles = 0, u64DecodeCycles = 0;
+   bool bFailed = false;
+
+   unsigned char U8Coded[TArq::MaxMessageLen + TextCodec::HeaderSize];
+   char C8Text[TArq::MaxMessageLen + 1];
+   for (auto const *C8Message : C8Corpus)
+   {
+      auto const u8Len = strlen(C8Message);
+      TextCodec::TBitCounter Counter = {};
+      TextCodec::ForEachSymbol(C8Message, u8Len, Counter);
+
+      auto const u8Coded = TextCodec::Encode(C8Message, u8Len, U8Coded);
+      auto const u8TextLen = TextCodec::Decode(U8Coded, u8Coded, C8Text, sizeof(C8Text));
+      if (u8TextLen != u8Len || strcmp(C8Text, C8Message))
+      {
+         printf("round trip failed: \"%s\" -> \"%s\"\n", C8Message, C8Text);
+         bFailed = true;
+      }
+
+      u32Plain += u8Len;
+      u32Packed += TextCodec::HeaderSize + (Counter.u16Packed + 7) / 8;
+      u32Huffman += TextCodec::HeaderSize + (Counter.u16Huffman + 7) / 8;
+      u32Coded += u8Coded;
+      auto const u8InPlace = CheckInPlace(C8Message, u8Len,
+                                          u8Len < MessengerTxSize ? MessengerTxSize : u8Len + TextCodec::HeaderSize);
+      if (!u8InPlace)
+      {
+         printf("in place round trip failed: \"%s\"\n", C8Message);
+         bFailed = true;
+      }
+
+      u32InPlace += u8InPlace;
+      U32Picked[U8Coded[0]]++;
+      u32PacketPlain += GetPacketAirBytes(u8Len);
+      u32PacketCoded += GetPacketAirBytes(u8Coded);
+      u32ArqPlain += GetArqAirBytes(u8Len);
+      u32ArqCoded += GetArqAirBytes(u8Coded);
+
+      auto u64Start = Now();
+      for (unsigned int i = 0; i < Iterations; i++)
+      {
+         TextCodec::Encode(C8Message, u8Len, U8Coded);
+         asm volatile("" ::: "memory");
+      }
+
+      u64EncodeCycles += Now() - u64Start;
+      u64Start = Now();
+      for (unsigned int i = 0; i < Iterations; i++)
+      {
+         TextCodec::Decode(U8Coded, u8Coded, C8Text, sizeof(C8Text));
+         asm volatile("" ::: "memory");
+      }
+
+      u64DecodeCycles += Now() - u64Start;
+   }
+
+   printf("%u messages, %.1f chars average\n", Messages, (double)u32Plain / Messages);
+   printf("bytes       plain  packed  huffman  picked\n");
+   printf("total    %8u %7u %8u %7u\n", u32Plain, u32Packed, u32Huffman, u32Coded);
+   printf("per char %8.2f %7.2f %8.2f %7.2f\n", 1.0, (double)u32Packed / u32Plain,
+          (double)u32Huffman / u32Plain, (double)u32Coded / u32Plain);
+   printf("in place, %u byte buffer or a header longer than the text: %u bytes\n", MessengerTxSize, u32InPlace);
+   printf("picked: plain %u, packed %u, huffman %u\n", U32Picked[TextCodec::Plain],
+          U32Picked[TextCodec::Packed], U32Picked[TextCodec::Huffman]);
+   printf("air time   fec packet %5.1f ms -> %5.1f ms (-%.1f%%), arq fragments %5.1f ms -> %5.1f ms (-%.1f%%)\n",
+          Sim::CyclesToMs((unsigned long long)u32PacketPlain * Sim::CBK4819Model::FskByteCycles) / Messages,
+          Sim::CyclesToMs((unsigned long long)u32PacketCoded * Sim::CBK4819Model::FskByteCycles) / Messages,
+          100.0 - 100.0 * u32PacketCoded / u32PacketPlain,
+          Sim::CyclesToMs((unsigned long long)u32ArqPlain * Sim::CBK4819Model::FskByteCycles) / Messages,
+          Sim::CyclesToMs((unsigned long long)u32ArqCoded * Sim::CBK4819Model::FskByteCycles) / Messages,
+          100.0 - 100.0 * u32ArqCoded / u32ArqPlain);
+   printf("host cycles per message: encode %.0f, decode %.0f\n",
+          (double)u64EncodeCycles / (Messages * Iterations),
+          (double)u64DecodeCycles / (Messages * Iterations));
+
+   if (!CheckRandomInPlace())
+   {
+      printf("coding random T9 text in place broke it\n");
+      bFailed = true;
+   }
+
+   if (!CheckRandomInput())
+   {
+      printf("decoding random input ran past the buffer\n");
+      bFailed = true;
+   }
+
+   printf("%s\n", bFailed ? "FAILED" : "ok");
+   return bFailed;
+}
@@ -0,0 +1,209 @@
+#include "sim.hpp"
+#include "uv_k5_display.hpp"
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// host cost of CDisplay draw calls, paged fast path vs the generic one
+// going through the virtual SetPixel for every pixel. Both have to leave
+// the same framebuffer behind. Text is checked against glyphs plotted
+// pixel by pixel, at page aligned and shifted y and at the screen edges.
+// usage: draw_bench
+
+struct TPixelDisplay : public TUV_K5Display
+{
+   static constexpr bool PagedLayout = false;
+   constexpr TPixelDisplay(const unsigned char *p8ScreenData) : TUV_K5Display(p8ScreenData){};
+};
+
+static constexpr auto ScreenBytes = TUV_K5Display::Pages * TUV_K5Display::SizeX;
+static unsigned char U8Reference[ScreenBytes];
+
+TUV_K5Display DisplayBuff(gDisplayBuffer);
+CDisplay<const TUV_K5Display> Display(DisplayBuff);
+
+TPixelDisplay PixelBuff(gDisplayBuffer);
+CDisplay<const TPixelDisplay> PixelDisplay(PixelBuff);
+
+const TUV_K5SmallNumbers FontSmallNr(gSmallDigs);
+
+static constexpr auto Iterations = 2000;
+
+static unsigned long long Now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+       .count();
+#endif
+}
+
+// spectrum_fagci frame: 128 columns from 0 to 42 pixels high
+template <class DisplayType>
+static void SpectrumColumns(DisplayType &Disp)
+{
+   for (unsigned char x = 0; x < 128; x++)
+   {
+      Disp.DrawHLine(48 - ((x * 7) % 43), 48, x);
+   }
+}
+
+template <class DisplayType>
+static void DashedLine(DisplayType &Disp)
+{
+   Disp.DrawHLine(0, 55, 64, true);
+}
+
+template <class DisplayType>
+static void HorizontalLine(DisplayType &Disp)
+{
+   Disp.DrawLine(0, 127, 20);
+}
+
+template <class DisplayType>
+static void Arrow(DisplayType &Disp)
+{
+   Disp.DrawLine(60, 62, 3);
+}
+
+template <class DisplayType>
+static void FilledRectangle(DisplayType &Disp)
+{
+   Disp.DrawRectangle(30, 21, 7, 7, true);
+}
+
+template <class DisplayType>
+static void Frame(DisplayType &Disp)
+{
+   Disp.DrawRectangle(0, 26, 127, 30, false);
+}
+
+template <class DisplayType>
+static double Measure(void (*pDraw)(DisplayType &), DisplayType &Disp)
+{
+   memset(gDisplayBuffer, 0, ScreenBytes);
+   auto const u64Start = Now();
+   for (unsigned int i = 0; i < Iterations; i++)
+   {
+      pDraw(Disp);
+   }
+
+   return (double)(Now() - u64Start) / Iterations;
+}
+
+static const char C8Text[] = "0123456789";
+
+struct TTextCase
+{
+   unsigned char u8X;
+   unsigned char u8Y;
+};
+
+// aligned, shifted, clipped at the right and at the bottom edge
+static constexpr TTextCase TextCases[] = {{3, 8}, {3, 11}, {100, 21}, {40, 52}};
+
+static void PrintText(const TTextCase &Case)
+{
+   Display.SetCoursorXY(Case.u8X, Case.u8Y);
+   Display.Print(C8Text);
+}
+
+static void PlotText(const TTextCase &Case)
+{
+   unsigned short u16X = Case.u8X;
+   for (const char *pC8 = C8Text; *pC8; pC8++)
+   {
+      auto const *pGlyph = FontSmallNr.GetRaw(*pC8);
+      for (unsigned char i = 0; i < FontSmallNr.GetSizeY(*pC8); i++, u16X++)
+      {
+         for (unsigned char u8Bit = 0; u8Bit < 8; u8Bit++)
+         {
+            unsigned short const u16Y = Case.u8Y + u8Bit;
+            if ((pGlyph[i] >> u8Bit) & 1 && u16X < 128 && u16Y < 56)
+               PixelBuff.SetPixel(u16X, u16Y);
+         }
+      }
+   }
+}
+
+static bool CheckText(const TTextCase &Case)
+{
+   memset(gDisplayBuffer, 0, ScreenBytes);
+   PlotText(Case);
+   memcpy(U8Reference, gDisplayBuffer, sizeof(U8Reference));
+   memset(gDisplayBuffer, 0, ScreenBytes);
+   PrintText(Case);
+   return !memcmp(U8Reference, gDisplayBuffer, sizeof(U8Reference));
+}
+
+static double MeasureText(const TTextCase &Case)
+{
+   memset(gDisplayBuffer, 0, ScreenBytes);
+   auto const u64Start = Now();
+   for (unsigned int i = 0; i < Iterations; i++)
+   {
+      PrintText(Case);
+   }
+
+   return (double)(Now() - u64Start) / Iterations;
+}
+
+struct TCase
+{
+   const char *C8Name;
+   void (*pPaged)(CDisplay<const TUV_K5Display> &);
+   void (*pPixel)(CDisplay<const TPixelDisplay> &);
+};
+
+#define BENCH_CASE(Name) {#Name, Name, Name}
+
+static const TCase Cases[] = {
+    BENCH_CASE(SpectrumColumns),
+    BENCH_CASE(DashedLine),
+    BENCH_CASE(HorizontalLine),
+    BENCH_CASE(Arrow),
+    BENCH_CASE(FilledRectangle),
+    BENCH_CASE(Frame),
+};
+
+int main()
+{
+   Sim::Init();
+
+#if defined(__x86_64__) || defined(__i386__)
+   const char *C8Unit = "tsc/call";
+#else
+   const char *C8Unit = "ns/call";
+#endif
+   printf("%-16s %12s %12s %8s\n", "draw", "pixel", "paged", C8Unit);
+
+   bool bMismatch = false;
+   for (auto const &Case : Cases)
+   {
+      auto const f64Pixel = Measure(Case.pPixel, PixelDisplay);
+      memcpy(U8Reference, gDisplayBuffer, sizeof(U8Reference));
+      auto const f64Paged = Measure(Case.pPaged, Display);
+      bool const bSame = !memcmp(U8Reference, gDisplayBuffer, sizeof(U8Reference));
+      bMismatch |= !bSame;
+
+      printf("%-16s %12.1f %12.1f %7.1fx%s\n", Case.C8Name, f64Pixel, f64Paged,
+             f64Pixel / f64Paged, bSame ? "" : "  MISMATCH");
+   }
+
+   Display.SetFont(&FontSmallNr);
+   printf("\n%-16s %12s %8s\n", "text (10 chars)", "x,y", C8Unit);
+   for (auto const &Case : TextCases)
+   {
+      bool const bSame = CheckText(Case);
+      bMismatch |= !bSame;
+      printf("%-16s %8u,%-3u %8.1f%s\n", "Print", Case.u8X, Case.u8Y,
+             MeasureText(Case), bSame ? "" : "  MISMATCH");
+   }
+
+   return bMismatch;
+}
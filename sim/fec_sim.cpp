@@ -0,0 +1,185 @@
+#include "sim.hpp"
+#include "radio.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// sends messenger packets through CBK4819 and the BK4819 fsk model with
+// bits flipped on the way, plain and Fec coded, and counts the ones that
+// arrive intact: random errors at a few bit error rates, then one burst
+// per packet. Fails when an error free packet or a Fec packet hit by a
+// burst of up to 8 bits is lost or has a codeword beyond repair, or a
+// broken one or one of another Packet kind gets through
+// usage: fec_sim [packets]
+
+Radio::CBK4819 RadioDriver;
+
+namespace
+{
+   struct TReceiver
+   {
+      bool bDone;
+      bool bCrcOk;
+      unsigned char u8Len;
+
+      void RxDoneHandler(unsigned char u8DataLen, bool bCrc)
+      {
+         bDone = true;
+         bCrcOk = bCrc;
+         u8Len = u8DataLen;
+      }
+   };
+
+   struct TResult
+   {
+      unsigned int u32Sent;
+      unsigned int u32Ok;
+      unsigned int u32FalseAccepts;
+      unsigned int u32Corrected;
+      unsigned int u32Unfixed; // codewords Fec found beyond repair
+      unsigned long long u64AirCycles;
+   };
+
+   TReceiver Receiver;
+   Radio::TRxRing RxRing;
+   unsigned char U8RxBuff[72];
+   unsigned char U8Air[Sim::CBK4819Model::FskMaxAirLen];
+   unsigned int u32Seed = 0x12345678;
+
+   unsigned int Random()
+   {
+      u32Seed ^= u32Seed << 13;
+      u32Seed ^= u32Seed >> 17;
+      u32Seed ^= u32Seed << 5;
+      return u32Seed;
+   }
+
+   // u32BerPpm flips each bit with that chance, u8Burst flips that many
+   // bits in a row at a random place. Text packets go out, the receiver
+   // waits for RxKind
+   void SendOne(bool bFec, unsigned int u32BerPpm, unsigned char u8Burst, Packet::eKind RxKind,
+                TResult &Result)
+   {
+      // messenger sized text
+      unsigned char U8Payload[50];
+      unsigned char const u8Len = 1 + Random() % sizeof(U8Payload);
+      for (unsigned char i = 0; i < u8Len; i++)
+      {
+         U8Payload[i] = 'a' + Random() % 26;
+      }
+
+      auto const u64TxStart = Sim::GetStats().u64Cycles;
+      RadioDriver.SendSyncPacket(Packet::eKind::Text, Result.u32Sent, U8Payload, u8Len, bFec);
+      Result.u64AirCycles += Sim::GetStats().u64Cycles - u64TxStart;
+
+      auto const u16AirLen = Sim::BK4819.GetTxFrameLen();
+      memcpy(U8Air, Sim::BK4819.GetTxFrame(), u16AirLen);
+      for (unsigned short i = 0; u32BerPpm && i < u16AirLen * 8; i++)
+      {
+         if (Random() % 1000000 < u32BerPpm)
+         {
+            U8Air[i / 8] ^= 1 << (i % 8);
+         }
+      }
+
+      if (u8Burst)
+      {
+         unsigned short const u16Start = Random() % (u16AirLen * 8 - u8Burst + 1);
+         for (unsigned short i = u16Start; i < u16Start + u8Burst; i++)
+         {
+            U8Air[i / 8] ^= 1 << (i % 8);
+         }
+      }
+
+      Receiver = {};
+      memset(U8RxBuff, 0, sizeof(U8RxBuff));
+      RadioDriver.RecieveAsyncPacket(RxRing, U8RxBuff, sizeof(U8RxBuff),
+                                     Radio::CallbackRxDoneType(&Receiver, &TReceiver::RxDoneHandler),
+                                     RxKind, bFec);
+      Sim::BK4819.StartRxFrame(U8Air, u16AirLen);
+      for (unsigned short u16Tick = 0; u16Tick < 300 && !Receiver.bDone; u16Tick++)
+      {
+         RadioDriver.InterruptHandler();
+         RadioDriver.HandleRx();
+         Sim::WaitForNextTick();
+      }
+
+      bool const bIntact = Receiver.u8Len == u8Len &&
+                           !memcmp(U8RxBuff + Packet::HeaderSize, U8Payload, u8Len);
+      Result.u32Sent++;
+      Result.u32Ok += Receiver.bDone && Receiver.bCrcOk && bIntact;
+      Result.u32FalseAccepts += Receiver.bDone && Receiver.bCrcOk && !bIntact;
+      Result.u32Corrected += RadioDriver.u8RxCorrected;
+      Result.u32Unfixed += RadioDriver.u8RxFailed;
+   }
+
+   TResult Run(unsigned int u32Packets, bool bFec, unsigned int u32BerPpm, unsigned char u8Burst,
+               Packet::eKind RxKind = Packet::eKind::Text)
+   {
+      TResult Result = {};
+      for (unsigned int i = 0; i < u32Packets; i++)
+      {
+         SendOne(bFec, u32BerPpm, u8Burst, RxKind, Result);
+      }
+
+      return Result;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   unsigned int u32Packets = argc > 1 ? atoi(argv[1]) : 200;
+   if (!u32Packets)
+   {
+      return 0;
+   }
+
+   Sim::Init();
+
+   static constexpr unsigned int BerPpm[] = {0, 1000, 3000, 10000, 20000};
+   static constexpr unsigned char Bursts[] = {4, 8, 12, 16};
+   bool bFailed = false;
+
+   printf("errors          plain ok   fec ok  fixed/pkt  unfixed/pkt  false accepts\n");
+   for (auto const u32Ber : BerPpm)
+   {
+      auto const PlainResult = Run(u32Packets, false, u32Ber, 0);
+      auto const FecResult = Run(u32Packets, true, u32Ber, 0);
+      printf("ber %6.4f%%  %10.1f%% %7.1f%% %10.2f %12.2f %14u\n", u32Ber / 10000.0,
+             100.0 * PlainResult.u32Ok / u32Packets, 100.0 * FecResult.u32Ok / u32Packets,
+             (double)FecResult.u32Corrected / u32Packets, (double)FecResult.u32Unfixed / u32Packets,
+             PlainResult.u32FalseAccepts + FecResult.u32FalseAccepts);
+      bFailed |= PlainResult.u32FalseAccepts || FecResult.u32FalseAccepts;
+      bFailed |= !u32Ber && (PlainResult.u32Ok != u32Packets || FecResult.u32Ok != u32Packets ||
+                             FecResult.u32Unfixed);
+   }
+
+   for (auto const u8Burst : Bursts)
+   {
+      auto const PlainResult = Run(u32Packets, false, 0, u8Burst);
+      auto const FecResult = Run(u32Packets, true, 0, u8Burst);
+      printf("burst %2u bit  %10.1f%% %7.1f%% %10.2f %12.2f %14u\n", u8Burst,
+             100.0 * PlainResult.u32Ok / u32Packets, 100.0 * FecResult.u32Ok / u32Packets,
+             (double)FecResult.u32Corrected / u32Packets, (double)FecResult.u32Unfixed / u32Packets,
+             PlainResult.u32FalseAccepts + FecResult.u32FalseAccepts);
+      bFailed |= PlainResult.u32FalseAccepts || FecResult.u32FalseAccepts;
+      bFailed |= u8Burst <= Fec::BlockAir && (FecResult.u32Ok != u32Packets || FecResult.u32Unfixed);
+   }
+
+   // a peer speaking another protocol gets nothing through
+   auto const PlainOther = Run(u32Packets, false, 0, 0, Packet::eKind::Arq);
+   auto const FecOther = Run(u32Packets, true, 0, 0, Packet::eKind::Arq);
+   printf("other kind    %10.1f%% %7.1f%%\n", 100.0 * PlainOther.u32Ok / u32Packets,
+          100.0 * FecOther.u32Ok / u32Packets);
+   bFailed |= PlainOther.u32Ok || FecOther.u32Ok || PlainOther.u32FalseAccepts || FecOther.u32FalseAccepts;
+
+   auto const PlainResult = Run(u32Packets, false, 0, 0);
+   auto const FecResult = Run(u32Packets, true, 0, 0);
+   printf("tx time per packet: plain %.1f ms, fec %.1f ms, 72 byte aircopy %.1f ms\n",
+          Sim::CyclesToMs(PlainResult.u64AirCycles) / u32Packets,
+          Sim::CyclesToMs(FecResult.u64AirCycles) / u32Packets,
+          Sim::CyclesToMs((unsigned long long)(Sim::CBK4819Model::FskPreambleBytes + 72) *
+                          Sim::CBK4819Model::FskByteCycles));
+   printf("%s\n", bFailed ? "FAILED" : "ok");
+   return bFailed;
+}
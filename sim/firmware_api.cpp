@@ -0,0 +1,431 @@
+#include "sim.hpp"
+#include "system.hpp"
+#include "st7565.hpp"
+#include "bk4819_spi.hpp"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+// peripherals
+TPort Sim::Port;
+TGpio Sim::GpioA;
+TGpio Sim::GpioB;
+TGpio Sim::GpioC;
+TSysCon Sim::SysCon;
+TAdc Sim::Adc;
+TSysTick Sim::SysTickTimer;
+TSpi Sim::Spi0;
+TFlash Sim::FlashCtrl;
+
+// stock firmware RAM / flash data
+unsigned char gDisplayBuffer[128 * 7];
+unsigned char gStatusBarData[128];
+unsigned char gSmallLeters[128 * 4];
+unsigned char gFlashLightStatus;
+unsigned short gVoltage;
+
+// 7 columns per glyph, '0'..'9' and '-'
+unsigned char gSmallDigs[7 * 11] = {
+    0x3E, 0x41, 0x41, 0x41, 0x3E, 0x00, 0x00, // 0
+    0x00, 0x42, 0x7F, 0x40, 0x00, 0x00, 0x00, // 1
+    0x62, 0x51, 0x49, 0x49, 0x46, 0x00, 0x00, // 2
+    0x22, 0x41, 0x49, 0x49, 0x36, 0x00, 0x00, // 3
+    0x18, 0x14, 0x12, 0x7F, 0x10, 0x00, 0x00, // 4
+    0x27, 0x45, 0x45, 0x45, 0x39, 0x00, 0x00, // 5
+    0x3E, 0x49, 0x49, 0x49, 0x32, 0x00, 0x00, // 6
+    0x01, 0x71, 0x09, 0x05, 0x03, 0x00, 0x00, // 7
+    0x36, 0x49, 0x49, 0x49, 0x36, 0x00, 0x00, // 8
+    0x26, 0x49, 0x49, 0x49, 0x3E, 0x00, 0x00, // 9
+    0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, // -
+};
+
+namespace
+{
+   Sim::TStats Stats;
+   unsigned char u8Key = 0xFF;
+
+   // what the ST7565 shows, lcd line 0 is the status bar
+   unsigned char U8Panel[8][132];
+   unsigned char u8PanelLine;
+   unsigned char u8PanelColumn;
+
+   unsigned char U8Flash[Sim::FlashSize];
+   unsigned int U32FlashErases[Sim::FlashSize / 512];
+   unsigned int u32FlashPower;
+
+   void ChargeLcdBytes(unsigned int u32Bytes)
+   {
+      Stats.u32LcdBytes += u32Bytes;
+      Sim::Charge((unsigned long long)u32Bytes * Sim::LcdByteCycles);
+   }
+
+   void ChargeLcd(unsigned int u32Pages)
+   {
+      Stats.u32LcdFlushes++;
+      ChargeLcdBytes(u32Pages * (128 + Sim::LcdPageCmdBytes));
+   }
+}
+
+void St7565::BeginTransfer()
+{
+   SPI0->CR &= ~SPI_CR_MSR_SSN;
+}
+
+void St7565::EndTransfer()
+{
+   SPI0->CR |= SPI_CR_MSR_SSN;
+   Stats.u32LcdFlushes++;
+}
+
+void St7565::SelectColumnAndLine(unsigned char u8Column, unsigned char u8Line)
+{
+   GPIOB->DATA &= ~GPIO_PIN_9;
+   u8PanelLine = u8Line & 7;
+   u8PanelColumn = u8Column;
+   ChargeLcdBytes(Sim::LcdPageCmdBytes);
+}
+
+void St7565::WriteData(const unsigned char *p8Data, unsigned char u8Len)
+{
+   GPIOB->DATA |= GPIO_PIN_9;
+   ChargeLcdBytes(u8Len);
+   while (u8Len--)
+   {
+      if (u8PanelColumn < sizeof(*U8Panel))
+         U8Panel[u8PanelLine][u8PanelColumn] = *p8Data;
+      u8PanelColumn++;
+      p8Data++;
+   }
+}
+
+void Bk4819Spi::SimWrite(unsigned char u8Address, unsigned short u16Data,
+                         unsigned char u8HalfBitCycles)
+{
+   Stats.u32RegWrites++;
+   Sim::Charge(Sim::NativeTransferCycles +
+               24 * (2 * u8HalfBitCycles + Sim::NativeBitCycles));
+   Sim::BK4819.Write(u8Address, u16Data);
+}
+
+unsigned short Bk4819Spi::SimRead(unsigned char u8Address, unsigned char u8HalfBitCycles)
+{
+   Stats.u32RegReads++;
+   Sim::Charge(Sim::NativeTransferCycles + u8HalfBitCycles +
+               24 * (2 * u8HalfBitCycles + Sim::NativeBitCycles));
+   return Sim::BK4819.Read(u8Address);
+}
+
+bool Sim::IsPanelInSync()
+{
+   for (unsigned char u8Line = 0; u8Line < 7; u8Line++)
+   {
+      if (memcmp(&U8Panel[1 + u8Line][St7565::ColumnOffset],
+                 gDisplayBuffer + u8Line * 128, 128))
+         return false;
+   }
+
+   return true;
+}
+
+void Sim::Init(unsigned int u32Frequency)
+{
+   memset(&Port, 0, sizeof(Port));
+   memset(&SysCon, 0, sizeof(SysCon));
+   memset(&Adc, 0, sizeof(Adc));
+   for (auto &Channel : Adc.CHANNEL)
+   {
+      Channel.STAT = 1;
+   }
+
+   SysTickTimer.CTRL = 0b111;
+   SysTickTimer.LOAD = TickCycles - 1;
+   SysTickTimer.VAL = SysTickTimer.LOAD;
+
+   GpioA = {};
+   GpioB = {GPIO_PIN_9, 0};             // lcd A0 idle
+   GpioC = {GPIO_PIN_0 | GPIO_PIN_5, 0}; // bk4819 SCN idle, ptt released
+
+   Spi0 = {};
+   Spi0.CR = SPI_CR_MSR_SSN;
+   memset(U8Panel, 0, sizeof(U8Panel));
+   memset(gDisplayBuffer, 0, sizeof(gDisplayBuffer));
+   memset(gStatusBarData, 0, sizeof(gStatusBarData));
+   gFlashLightStatus = 0;
+   gVoltage = 780;
+   u8Key = 0xFF;
+
+   FlashCtrl = {};
+   memset(U8Flash, 0xFF, sizeof(U8Flash));
+   memset(U32FlashErases, 0, sizeof(U32FlashErases));
+   u32FlashPower = ~0u;
+
+   BK4819.Reset(u32Frequency);
+   Stats = {};
+}
+
+Sim::TStats &Sim::GetStats()
+{
+   return Stats;
+}
+
+void Sim::ResetStats()
+{
+   auto const u64Cycles = Stats.u64Cycles; // time keeps running
+   Stats = {};
+   Stats.u64Cycles = u64Cycles;
+}
+
+void Sim::Charge(unsigned long long u64Cycles)
+{
+   Stats.u64Cycles += u64Cycles;
+   SysTickTimer.VAL = SysTickTimer.LOAD - (Stats.u64Cycles % TickCycles);
+}
+
+unsigned long long Sim::WaitForNextTick()
+{
+   auto const u64Idle = TickCycles - (Stats.u64Cycles % TickCycles);
+   Charge(u64Idle);
+   return u64Idle;
+}
+
+void Sim::SetKey(unsigned char u8NewKey)
+{
+   u8Key = u8NewKey;
+}
+
+void Sim::PrintFramebuffer()
+{
+   for (unsigned char u8Y = 0; u8Y < 56; u8Y++)
+   {
+      char C8Line[129];
+      for (unsigned char u8X = 0; u8X < 128; u8X++)
+      {
+         bool bSet = gDisplayBuffer[(u8Y >> 3) * 128 + u8X] & (1 << (u8Y & 7));
+         C8Line[u8X] = bSet ? '#' : '.';
+      }
+
+      C8Line[128] = '\0';
+      printf("%s\n", C8Line);
+   }
+}
+
+const unsigned char *Sim::GetFlash()
+{
+   return U8Flash;
+}
+
+unsigned int Sim::GetFlashErases(unsigned int u32Address)
+{
+   return U32FlashErases[(u32Address % FlashSize) / 512];
+}
+
+void Sim::CutFlashPowerAfter(unsigned int u32Operations)
+{
+   u32FlashPower = u32Operations;
+}
+
+extern "C" {
+void PrintTextOnScreen(const char *U8Text, unsigned int u32StartPixel,
+                       unsigned int u32StopPixel, unsigned int u32LineNumber,
+                       unsigned int u32PxPerChar, unsigned int u32Centered)
+{
+   Sim::Charge((unsigned long long)strlen(U8Text) * Sim::PrintCharCycles);
+}
+
+void DelayMs(unsigned int u32Ms)
+{
+   DelayUs(u32Ms * 1000);
+}
+
+void DelayUs(unsigned int u32Us)
+{
+   auto const u64Cycles = (unsigned long long)u32Us * Sim::CyclesPerUs;
+   Stats.u64DelayCycles += u64Cycles;
+   Sim::Charge(u64Cycles);
+}
+
+int WriteSerialData(unsigned char *p8Data, unsigned char u8Len)
+{
+   return u8Len;
+}
+
+void BK4819Write(unsigned int u32Address, unsigned int u32Data)
+{
+   Stats.u32RegWrites++;
+   Sim::Charge(Sim::BK4819WriteCycles);
+   Sim::BK4819.Write(u32Address, u32Data);
+}
+
+unsigned int BK4819Read(unsigned int u32Address)
+{
+   Stats.u32RegReads++;
+   Sim::Charge(Sim::BK4819ReadCycles);
+   return Sim::BK4819.Read(u32Address);
+}
+
+void FlushFramebufferToScreen(void)
+{
+   for (unsigned char u8Line = 0; u8Line < 7; u8Line++)
+      memcpy(&U8Panel[1 + u8Line][St7565::ColumnOffset], gDisplayBuffer + u8Line * 128, 128);
+   ChargeLcd(7);
+}
+
+void FlushStatusbarBufferToScreen()
+{
+   memcpy(&U8Panel[0][St7565::ColumnOffset], gStatusBarData, 128);
+   ChargeLcd(1);
+}
+
+unsigned int PollKeyboard(void)
+{
+   Stats.u32KeyboardPolls++;
+   Sim::Charge(Sim::PollKeyboardCycles);
+   return u8Key;
+}
+
+char *FormatString(char *C8Dest, const char *C8Format, ...)
+{
+   va_list Args;
+   va_start(Args, C8Format);
+   vsprintf(C8Dest, C8Format, Args);
+   va_end(Args);
+   Sim::Charge(Sim::FormatStringCycles);
+   return C8Dest;
+}
+
+void PrintSmallDigits(unsigned int u32Len, const int *p32Number, int s32X, int s32Y)
+{
+   Sim::Charge(u32Len * Sim::PrintCharCycles);
+}
+
+void PrintFrequency(int frequency, int xpos, int ypos, int param_4, int param_5)
+{
+   Sim::Charge(8 * Sim::PrintCharCycles);
+}
+
+// the stock BK4819 helpers below approximate the register traffic of the
+// original routines, exact values don't matter for the cost model
+void BK4819SetChannelBandwidth(bool narrow)
+{
+   auto const u32Reg = BK4819Read(0x43);
+   BK4819Write(0x43, narrow ? (u32Reg & ~(0b111 << 12)) : (u32Reg | (0b111 << 12)));
+}
+
+void BK4819WriteFrequency(unsigned int u32Frequency)
+{
+   BK4819Write(0x38, u32Frequency & 0xFFFF);
+   BK4819Write(0x39, (u32Frequency >> 16) & 0xFFFF);
+}
+
+void BK4819SetGpio(unsigned int u32Pin, bool bState)
+{
+   auto const u32Reg = Sim::BK4819.GetRegister(0x33);
+   BK4819Write(0x33, bState ? (u32Reg | (1 << u32Pin)) : (u32Reg & ~(1 << u32Pin)));
+}
+
+void AirCopy72(unsigned char *p8Data)
+{
+   for (unsigned char i = 0; i < 72 / 2; i++)
+   {
+      BK4819Write(0x5F, p8Data[2 * i] | (p8Data[2 * i + 1] << 8));
+   }
+}
+
+void AirCopyFskSetup()
+{
+   BK4819Write(0x70, 0x00E0);
+   BK4819Write(0x72, 0x3065);
+   BK4819Write(0x58, 0x00C1);
+   BK4819Write(0x5C, 0x5665);
+   BK4819Write(0x5D, 0x4700);
+}
+
+void BK4819ConfigureAndStartTxFsk()
+{
+   BK4819Write(0x30, 0xC1FE);
+}
+
+void BK4819ConfigureAndStartRxFsk()
+{
+   BK4819Write(0x59, 0x3068);
+   BK4819Write(0x30, 0xBFF1);
+}
+
+void BK4819Reset() {}
+void BK4819SetPaGain(unsigned short u16PaBias, unsigned int u32Frequency) {}
+void UpdateStatusBar() {}
+void SomeAmStuff(unsigned int u32Param) {}
+void IRQ_RESET(void) {}
+void IRQ_SYSTICK(void) {}
+
+void AdcReadout(unsigned short *p16Data1, unsigned short *p16Data2)
+{
+   *p16Data1 = 2048;
+   *p16Data2 = 2048;
+}
+
+int IntDivide(int s32Divident, int s32Divisor)
+{
+   return s32Divident / s32Divisor;
+}
+
+int Strlen(const char *string)
+{
+   return strlen(string);
+}
+
+// mode in CFG, ADDR counts words from the start of the chip
+void FLASH_SetMode(unsigned int u32Mode)
+{
+   Sim::FlashCtrl.CFG = u32Mode;
+}
+
+void FLASH_Start(void)
+{
+   if (!u32FlashPower)
+   {
+      return;
+   }
+
+   if (u32FlashPower != ~0u)
+   {
+      u32FlashPower--;
+   }
+
+   auto const u32Address = (Sim::FlashCtrl.ADDR << 2) % Sim::FlashSize;
+   if (Sim::FlashCtrl.CFG == 2)
+   {
+      Stats.u32FlashErases++;
+      Sim::Charge(Sim::FlashEraseCycles);
+      U32FlashErases[u32Address / 512]++;
+      memset(U8Flash + (u32Address & ~511u), 0xFF, 512);
+   }
+   else if (Sim::FlashCtrl.CFG == 1)
+   {
+      Stats.u32FlashWords++;
+      Sim::Charge(Sim::FlashProgramCycles);
+      for (unsigned char i = 0; i < 4; i++)
+      {
+         U8Flash[u32Address + i] &= Sim::FlashCtrl.WDATA >> (8 * i);
+      }
+   }
+}
+
+int FLASH_IsBusy(void)
+{
+   return 0;
+}
+
+void FLASH_Lock(void) {}
+void FLASH_Unlock(void) {}
+
+// u32Offset as the mod sees flash, above the 4K bootloader
+unsigned int FLASH_ReadByAHB(unsigned int u32Offset)
+{
+   Stats.u32FlashReads++;
+   Sim::Charge(Sim::FlashReadCycles);
+   unsigned int u32Word;
+   memcpy(&u32Word, U8Flash + ((0x1000 + (u32Offset & ~3u)) % Sim::FlashSize), 4);
+   return u32Word;
+}
+}
@@ -0,0 +1,154 @@
+#include "sim.hpp"
+#include "m0_int.hpp"
+#include "uv_k5_display.hpp"
+#include "number_format.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// number formatting: CDisplay::PrintFixed vs PrintFixedDigitsNumber2/3 and
+// NumberFormat vs the stock FormatString. Checks DivU10 and DivSmall10
+// against the divider and that old and new draw the same pixels, then
+// prints modeled M0 cycles per call: the number code runs on Sim::TM0Int,
+// every / and % charged as a call to the stock IntDivide. Glyph drawing,
+// loads, stores and loop counters are not charged, which favours the old
+// loops. FormatString is its modeled stock cost.
+// Fails on a wrong divide, a pixel or string mismatch, or no gain.
+// usage: format_bench
+
+static constexpr auto ScreenBytes = TUV_K5Display::Pages * TUV_K5Display::SizeX;
+static unsigned char U8Reference[ScreenBytes];
+
+TUV_K5Display DisplayBuff(gDisplayBuffer);
+CDisplay<const TUV_K5Display> Display(DisplayBuff);
+const TUV_K5SmallNumbers FontSmallNr(gSmallDigs);
+
+using TInt = Sim::TM0Int<int>;
+using TUInt = Sim::TM0Int<unsigned int>;
+
+static bool CheckDivU10()
+{
+   for (unsigned int i = 0; i < (1 << 24); i++)
+   {
+      if (NumberFormat::DivU10(i) != i / 10)
+         return false;
+   }
+
+   unsigned int u32Lfsr = 0xACE1;
+   for (unsigned int i = 0; i < (1 << 24); i++)
+   {
+      u32Lfsr = u32Lfsr * 1664525 + 1013904223;
+      if (NumberFormat::DivU10(u32Lfsr) != u32Lfsr / 10)
+         return false;
+   }
+
+   for (int i = 0; i < NumberFormat::SmallLimit; i++)
+   {
+      if (NumberFormat::DivSmall10(i) != i / 10)
+         return false;
+   }
+
+   return NumberFormat::DivU10(0xFFFFFFFF) == 0xFFFFFFFF / 10;
+}
+
+// spectrum_fagci DrawNums fields and the rssi_sbar S-meter / voltage,
+// each over the values it shows
+struct TField
+{
+   const char *C8Name;
+   int s32Min;
+   int s32Max;
+   void (*pOld)(int);
+   void (*pNew)(int);
+};
+
+#define FIXED3(Cut, Digits, Point)                                                \
+   [](int s32) { Display.PrintFixedDigitsNumber3<TInt>(s32, Cut, Digits, Point); }, \
+       [](int s32) { Display.PrintFixed<Cut, Digits, Point, TInt>(s32); }
+
+#define FIXED2(Cut, Digits)                                                \
+   [](int s32) { Display.PrintFixedDigitsNumber2<TInt>(s32, Cut, Digits); }, \
+       [](int s32) { Display.PrintFixed<Cut, Digits, 0, TInt>(s32); }
+
+static const TField Fields[] = {
+    {"peak 434.550", 1800000, 130000000, FIXED3(2, 6, 3)},
+    {"start 4330.0", 1800000, 130000000, FIXED3(4, 4, 1)},
+    {"span 1.60", 0, 999999, FIXED3(3, 3, 2)},
+    {"delay 3.2", 0, 9999, FIXED3(2, 2, 1)},
+    {"rssi -118", -160, 160, FIXED2(0, 3)},
+    {"volts 7", 500, 999, FIXED2(2, 1)},
+    {"volts .80", 500, 999, FIXED2(0, 2)},
+};
+
+// ranges up to this are swept, wider ones sampled as often
+static constexpr unsigned int Samples = 20000;
+
+// modeled M0 cycles of one call, drawn at the same place as the others
+template <class Func>
+static unsigned long long Measure(Func &&Call)
+{
+   auto const u64Start = Sim::GetStats().u64Cycles;
+   Call();
+   return Sim::GetStats().u64Cycles - u64Start;
+}
+
+static void Clear()
+{
+   memset(gDisplayBuffer, 0, ScreenBytes);
+   Display.SetCoursor(1, 10);
+}
+
+int main()
+{
+   Sim::Init();
+   Display.SetFont(&FontSmallNr);
+
+   bool bFailed = !CheckDivU10();
+   printf("DivU10, DivSmall10 %s\n\n", bFailed ? "WRONG" : "exact");
+
+   printf("%-16s %12s %12s %8s\n", "field", "old", "PrintFixed", "cycles");
+   for (auto const &Field : Fields)
+   {
+      unsigned int const u32Range = Field.s32Max - Field.s32Min + 1;
+      unsigned int const u32Count = u32Range < Samples ? u32Range : Samples;
+      unsigned int u32Lfsr = 0xACE1;
+      unsigned long long u64Old = 0, u64New = 0;
+      bool bSame = true;
+      for (unsigned int i = 0; i < u32Count; i++)
+      {
+         u32Lfsr = u32Lfsr * 1664525 + 1013904223;
+         int const s32Value = Field.s32Min + (int)(u32Range == u32Count ? i : u32Lfsr % u32Range);
+         Clear();
+         u64Old += Measure([&] { Field.pOld(s32Value); });
+         memcpy(U8Reference, gDisplayBuffer, sizeof(U8Reference));
+         Clear();
+         u64New += Measure([&] { Field.pNew(s32Value); });
+         bSame &= !memcmp(U8Reference, gDisplayBuffer, sizeof(U8Reference));
+      }
+
+      bFailed |= !bSame || u64New >= u64Old;
+      printf("%-16s %12.1f %12.1f %7.1fx%s\n", Field.C8Name, (double)u64Old / u32Count,
+             (double)u64New / u32Count, (double)u64Old / u64New, bSame ? "" : "  MISMATCH");
+   }
+
+   char C8Old[24], C8New[24];
+   FormatString(C8Old, "RSSI     %i", -118);
+   NumberFormat::Signed(NumberFormat::String(C8New, "RSSI     "), -118);
+   bFailed |= strcmp(C8Old, C8New) != 0;
+   FormatString(C8Old, "in 1: %05i   ", 4095);
+   NumberFormat::String(NumberFormat::Padded<5>(NumberFormat::String(C8New, "in 1: "), 4095), "   ");
+   bFailed |= strcmp(C8Old, C8New) != 0;
+
+   unsigned int const u32Value = 4294967;
+   auto const u64Format = Measure([&] { FormatString(C8Old, "MIC in    %u", u32Value); });
+   auto const u64Number = Measure([&] {
+      NumberFormat::Unsigned<TUInt>(NumberFormat::String(C8New, "MIC in    "), u32Value);
+   });
+   bFailed |= strcmp(C8Old, C8New) != 0 || u64Number >= u64Format;
+
+   printf("\n%-16s %12s %12s %8s\n", "label", "FormatString", "NumberFormat", "cycles");
+   printf("%-16s %12llu %12llu %7.1fx\n", "\"MIC in    %u\"", u64Format, u64Number,
+          (double)u64Format / u64Number);
+
+   return bFailed;
+}
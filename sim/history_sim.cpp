@@ -0,0 +1,241 @@
+#include "sim.hpp"
+#include "message_log.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// CMessageLog on the simulated flash. Appends random messages up to the
+// messenger rx payload and after every one restarts the log as after a
+// power cycle, then reads the whole history back newest first. Power is
+// cut at random points of appends, after that the older messages have to
+// be there as they were and the cut one either complete or gone. Prints
+// how many messages the ring holds, erases per sector and the flash cost
+// of start, append and read. Fails on a wrong, missing or resurrected
+// message, or sectors worn unevenly
+// usage: history_sim [messages]
+
+namespace
+{
+   static constexpr unsigned char MaxLen = 64;
+   static constexpr unsigned short MaxMessages = 5000;
+
+   struct TMessage
+   {
+      char C8Text[MaxLen + 1];
+      unsigned char u8Len;
+      bool bLost; // to a power cut
+   };
+
+   TMessage Messages[MaxMessages];
+   unsigned int u32Seed = 0x12345678;
+
+   unsigned int Random()
+   {
+      u32Seed ^= u32Seed << 13;
+      u32Seed ^= u32Seed >> 17;
+      u32Seed ^= u32Seed << 5;
+      return u32Seed;
+   }
+
+   // "#<number> " and random letters, the number tells which message came
+   void MakeMessage(TMessage &Message, unsigned short u16Number)
+   {
+      Message.u8Len = 1 + Random() % MaxLen;
+      auto const u8Prefix = snprintf(Message.C8Text, sizeof(Message.C8Text), "#%u ", u16Number);
+      for (unsigned char i = u8Prefix; i < Message.u8Len; i++)
+      {
+         Message.C8Text[i] = 'a' + Random() % 26;
+      }
+
+      if (Message.u8Len < u8Prefix)
+      {
+         Message.u8Len = u8Prefix;
+      }
+
+      Message.C8Text[Message.u8Len] = '\0';
+      Message.bLost = false;
+   }
+
+   struct TResult
+   {
+      unsigned int u32Errors;
+      unsigned int u32MinHeld;
+      unsigned int u32MaxHeld;
+      unsigned int u32MinErases;
+      unsigned int u32MaxErases;
+      unsigned int u32PowerCuts;
+      unsigned int u32InitReads;
+      unsigned long long u64AppendCycles;
+      unsigned long long u64ReadCycles;
+      unsigned int u32Reads;
+   };
+
+   // history newest first against the messages written, less the ones a
+   // power cut took. Right after a cut the newest may be missing
+   template <class TLog>
+   unsigned int CheckHistory(TLog &Log, unsigned short u16Next, bool bCutLast, TResult &Result)
+   {
+      char C8Text[MaxLen + 1];
+      unsigned int u32Held = 0;
+      int s32Expected = u16Next - 1;
+      for (unsigned char u8Age = 0; u8Age < 0xFF; u8Age++)
+      {
+         auto const u64Start = Sim::GetStats().u64Cycles;
+         auto const u8Len = Log.Read(u8Age, C8Text, sizeof(C8Text));
+         Result.u64ReadCycles += Sim::GetStats().u64Cycles - u64Start;
+         Result.u32Reads++;
+         auto const s32Number = u8Len && C8Text[0] == '#' ? atoi(C8Text + 1) : -1;
+         if (bCutLast && !u8Age && s32Number != s32Expected)
+         {
+            Messages[s32Expected].bLost = true;
+         }
+
+         while (s32Expected >= 0 && Messages[s32Expected].bLost)
+         {
+            s32Expected--;
+         }
+
+         if (!u8Len)
+         {
+            // an empty history with messages left to show
+            Result.u32Errors += !u8Age && s32Expected >= 0;
+            break;
+         }
+
+         auto const &Message = Messages[s32Number >= 0 ? s32Number : 0];
+         if (s32Number != s32Expected || u8Len != Message.u8Len || strcmp(C8Text, Message.C8Text))
+         {
+            printf("age %u: \"%s\", expected #%d\n", u8Age, C8Text, s32Expected);
+            Result.u32Errors++;
+            break;
+         }
+
+         u32Held++;
+         s32Expected--;
+      }
+
+      return u32Held;
+   }
+
+   template <unsigned int BaseAddress, unsigned char Sectors>
+   TResult Run(unsigned short u16Messages)
+   {
+      using TLog = CMessageLog<BaseAddress, Sectors>;
+      Sim::Init();
+      TResult Result = {};
+      Result.u32MinHeld = ~0u;
+
+      TLog Log;
+      Log.Init();
+      char C8Text[MaxLen + 1];
+      if (Log.Read(0, C8Text, sizeof(C8Text)))
+      {
+         printf("blank flash holds a message\n");
+         Result.u32Errors++;
+      }
+
+      bool bCutLast = false;
+      for (unsigned short u16Next = 0; u16Next < u16Messages;)
+      {
+         auto &Message = Messages[u16Next];
+         MakeMessage(Message, u16Next);
+         // a cut somewhere in the header, text or sector switch
+         bool const bCut = !(Random() % 8);
+         if (bCut)
+         {
+            Sim::CutFlashPowerAfter(Random() % (3 + Message.u8Len / 4));
+         }
+
+         auto const u64Start = Sim::GetStats().u64Cycles;
+         Log.Append(Message.C8Text, Message.u8Len);
+         Result.u64AppendCycles += Sim::GetStats().u64Cycles - u64Start;
+         Sim::CutFlashPowerAfter(~0u);
+
+         // power cycle
+         Log = TLog();
+         auto const u32Reads = Sim::GetStats().u32FlashReads;
+         Log.Init();
+         Result.u32InitReads += Sim::GetStats().u32FlashReads - u32Reads;
+
+         u16Next++;
+         bCutLast = bCut;
+         Result.u32PowerCuts += bCut;
+         auto const u32Held = CheckHistory(Log, u16Next, bCutLast, Result);
+         // the ring is filled once it wrapped
+         if (Sim::GetFlashErases(0x1000 + BaseAddress) > 1)
+         {
+            Result.u32MinHeld = u32Held < Result.u32MinHeld ? u32Held : Result.u32MinHeld;
+         }
+
+         Result.u32MaxHeld = u32Held > Result.u32MaxHeld ? u32Held : Result.u32MaxHeld;
+      }
+
+      Result.u32MinErases = ~0u;
+      for (unsigned char i = 0; i < Sectors; i++)
+      {
+         auto const u32Erases = Sim::GetFlashErases(BaseAddress + 0x1000 + i * Flash::SectorSize);
+         Result.u32MinErases = u32Erases < Result.u32MinErases ? u32Erases : Result.u32MinErases;
+         Result.u32MaxErases = u32Erases > Result.u32MaxErases ? u32Erases : Result.u32MaxErases;
+      }
+
+      // nothing outside the ring was touched
+      auto const *p8Flash = Sim::GetFlash();
+      for (unsigned int u32At = 0; u32At < Sim::FlashSize; u32At++)
+      {
+         auto const u32App = u32At - 0x1000;
+         if (u32App >= BaseAddress && u32App < BaseAddress + Sectors * Flash::SectorSize)
+         {
+            continue;
+         }
+
+         if (p8Flash[u32At] != 0xFF)
+         {
+            printf("flash written outside the ring at 0x%X\n", u32At);
+            Result.u32Errors++;
+            break;
+         }
+      }
+
+      // the ring wears as one, and a sector switch may be cut before its
+      // sequence word, so that sector gets erased again
+      Result.u32Errors += Result.u32MaxErases - Result.u32MinErases > 1 + Result.u32PowerCuts;
+      return Result;
+   }
+}
+
+int main(int argc, char **argv)
+{
+   unsigned int u32Messages = argc > 1 ? atoi(argv[1]) : 2000;
+   if (!u32Messages)
+   {
+      return 0;
+   }
+
+   if (u32Messages > MaxMessages)
+   {
+      u32Messages = MaxMessages;
+   }
+
+   bool bFailed = false;
+   printf("%u messages of 1..%u chars, power cut in 1 of 8 appends\n", u32Messages, MaxLen);
+   printf("sectors  held  erases/sector  cuts  init reads  append ms  read ms  errors\n");
+   TResult const Results[] = {
+       Run<0xEC00, 2>(u32Messages),
+       Run<0xE800, 4>(u32Messages),
+   };
+
+   unsigned char const U8Sectors[] = {2, 4};
+   for (unsigned char i = 0; i < 2; i++)
+   {
+      auto const &Result = Results[i];
+      printf("%7u %2u-%-3u %7u-%-7u %4u %11.1f %10.2f %8.2f %7u\n", U8Sectors[i],
+             Result.u32MinHeld, Result.u32MaxHeld, Result.u32MinErases, Result.u32MaxErases,
+             Result.u32PowerCuts, (double)Result.u32InitReads / u32Messages,
+             Sim::CyclesToMs(Result.u64AppendCycles) / u32Messages,
+             Sim::CyclesToMs(Result.u64ReadCycles) / Result.u32Reads, Result.u32Errors);
+      bFailed |= Result.u32Errors != 0;
+   }
+
+   printf("%s\n", bFailed ? "FAILED" : "ok");
+   return bFailed;
+}
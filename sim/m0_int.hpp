@@ -0,0 +1,69 @@
+#pragma once
+#include "sim.hpp"
+#include <type_traits>
+
+namespace Sim
+{
+   // integer of type T that charges what its arithmetic would cost on the
+   // M0, for benchmarks of code generic over its integer type. Only the
+   // operations are charged, loads, stores and loop control are not
+   template <class T>
+   class TM0Int
+   {
+   public:
+      TM0Int() = default;
+      TM0Int(T Value) : Value(Value) {}
+      template <class U>
+      explicit TM0Int(TM0Int<U> Other) : Value(T(U(Other))) {}
+
+      template <class U, class = std::enable_if_t<std::is_arithmetic_v<U>>>
+      explicit operator U() const
+      {
+         return U(Value);
+      }
+
+#define M0_INT_OP(Op, u32Cycles)                                      \
+   friend TM0Int operator Op(TM0Int Lhs, TM0Int Rhs)                   \
+   {                                                                   \
+      Charge(u32Cycles);                                               \
+      return TM0Int(T(Lhs.Value Op Rhs.Value));                        \
+   }                                                                   \
+   TM0Int &operator Op##=(TM0Int Rhs) { return *this = *this Op Rhs; }
+
+      M0_INT_OP(+, AluCycles)
+      M0_INT_OP(-, AluCycles)
+      M0_INT_OP(*, AluCycles)
+      M0_INT_OP(&, AluCycles)
+      M0_INT_OP(|, AluCycles)
+      M0_INT_OP(^, AluCycles)
+      M0_INT_OP(<<, AluCycles)
+      M0_INT_OP(>>, AluCycles)
+      M0_INT_OP(/, DivideCycles)
+      M0_INT_OP(%, DivideCycles)
+#undef M0_INT_OP
+
+#define M0_INT_COMPARE(Op)                                            \
+   friend bool operator Op(TM0Int Lhs, TM0Int Rhs)                     \
+   {                                                                   \
+      Charge(CompareCycles);                                           \
+      return Lhs.Value Op Rhs.Value;                                   \
+   }
+
+      M0_INT_COMPARE(==)
+      M0_INT_COMPARE(!=)
+      M0_INT_COMPARE(<)
+      M0_INT_COMPARE(<=)
+      M0_INT_COMPARE(>)
+      M0_INT_COMPARE(>=)
+#undef M0_INT_COMPARE
+
+      TM0Int operator-() const
+      {
+         Charge(AluCycles);
+         return TM0Int(T(-Value));
+      }
+
+   private:
+      T Value;
+   };
+}
@@ -0,0 +1,123 @@
+#include "sim.hpp"
+#include "radio.hpp"
+#include "bk4819_spi.hpp"
+#include <cstdio>
+
+// bins per second of a spectrum sweep on the simulated register bus,
+// CBK4819::SetFrequency vs SetFrequencyFast, and the cost of one register
+// access through the stock routines vs Bk4819Spi at a few SCL timings
+// usage: retune_bench
+
+Radio::CBK4819 RadioDriver;
+
+struct TSweep
+{
+   const char *C8Name;
+   unsigned int u32HalfSpan;
+   unsigned int u32Step;
+   unsigned int u32DwellUs;
+};
+
+// spectrum_fagci modes 0 (narrow, doubled dwell) and 6
+static constexpr TSweep Sweeps[] = {
+    {"16kHz/1kHz", 16_KHz, 1_KHz, 800 << 1},
+    {"1.6MHz/25kHz", 1600_KHz, 25_KHz, 800},
+};
+
+static constexpr auto SweepsCnt = 50;
+
+template <bool bFast>
+static void Sweep(const TSweep &Params)
+{
+   for (unsigned int f = 434_MHz - Params.u32HalfSpan;
+        f < 434_MHz + Params.u32HalfSpan; f += Params.u32Step)
+   {
+      if (bFast)
+         RadioDriver.SetFrequencyFast(f);
+      else
+         RadioDriver.SetFrequency(f);
+
+      RadioDriver.ToggleRXDSP(false);
+      RadioDriver.ToggleRXDSP(true);
+      if (Params.u32DwellUs)
+         DelayUs(Params.u32DwellUs);
+      BK4819Read(0x67);
+   }
+}
+
+template <bool bFast>
+static void Run(const TSweep &Params, bool bWithDwell)
+{
+   TSweep Sweep0 = Params;
+   if (!bWithDwell)
+      Sweep0.u32DwellUs = 0;
+
+   Sim::Init(434_MHz);
+   RadioDriver.InvalidateShadow();
+
+   auto const u32Bins = 2 * Params.u32HalfSpan / Params.u32Step;
+   for (unsigned int i = 0; i < SweepsCnt; i++)
+   {
+      RadioDriver.InvalidateShadow(); // once per tick, like the mods do
+      Sweep<bFast>(Sweep0);
+   }
+
+   auto const &Stats = Sim::GetStats();
+   auto const u32TotalBins = u32Bins * SweepsCnt;
+   printf("%-14s %-6s %-8s %10.0f %12.2f %12.2f\n", Params.C8Name,
+          bFast ? "fast" : "full", bWithDwell ? "dwell" : "bus",
+          1000.0 * u32TotalBins / Sim::CyclesToMs(Stats.u64Cycles),
+          (double)(Stats.u32RegReads + Stats.u32RegWrites) / u32TotalBins,
+          1000.0 * Sim::CyclesToMs(Stats.u64Cycles) / u32TotalBins);
+}
+
+static constexpr auto BusOps = 1000;
+
+template <class Write, class Read>
+static void RunBus(const char *C8Name, Write &&WriteOp, Read &&ReadOp)
+{
+   Sim::Init(434_MHz);
+   for (unsigned int i = 0; i < BusOps; i++)
+   {
+      WriteOp(0x47, i);
+   }
+   auto const f64WriteUs = 1000.0 * Sim::CyclesToMs(Sim::GetStats().u64Cycles) / BusOps;
+
+   auto const u64Start = Sim::GetStats().u64Cycles;
+   for (unsigned int i = 0; i < BusOps; i++)
+   {
+      ReadOp(0x67);
+   }
+   auto const f64ReadUs = 1000.0 * Sim::CyclesToMs(Sim::GetStats().u64Cycles - u64Start) / BusOps;
+   printf("%-14s %10.2f %10.2f\n", C8Name, f64WriteUs, f64ReadUs);
+}
+
+template <unsigned char HalfBitCycles>
+static void RunNative(const char *C8Name)
+{
+   RunBus(
+       C8Name, [](unsigned char u8Address, unsigned short u16Data) { Bk4819Spi::Write<HalfBitCycles>(u8Address, u16Data); },
+       [](unsigned char u8Address) { Bk4819Spi::Read<HalfBitCycles>(u8Address); });
+}
+
+int main()
+{
+   printf("%-14s %-6s %-8s %10s %12s %12s\n", "sweep", "retune", "timing",
+          "bins/s", "spi/bin", "us/bin");
+   for (auto const &Params : Sweeps)
+   {
+      Run<false>(Params, false);
+      Run<true>(Params, false);
+      Run<false>(Params, true);
+      Run<true>(Params, true);
+   }
+
+   printf("\n%-14s %10s %10s\n", "bus", "write[us]", "read[us]");
+   RunBus("stock", [](unsigned char u8Address, unsigned short u16Data) { BK4819Write(u8Address, u16Data); },
+          [](unsigned char u8Address) { BK4819Read(u8Address); });
+   RunNative<Bk4819Spi::DefaultHalfBitCycles>("native default");
+   RunNative<12>("native 12");
+   RunNative<0>("native 0");
+
+   return 0;
+}
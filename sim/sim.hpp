@@ -0,0 +1,157 @@
+#pragma once
+#include "registers.hpp"
+
+// Host simulation of the stock firmware API used by the mods.
+// Every call into the "firmware" is charged an estimated cost in core cycles,
+// so sweep time and register traffic per frame can be compared between
+// changes without a radio. Code of the mods itself is not charged.
+namespace Sim
+{
+   static constexpr unsigned int CpuClockHz = 48000000;
+   static constexpr unsigned int CyclesPerUs = CpuClockHz / 1000000;
+   static constexpr unsigned int TickCycles = CpuClockHz / 100; // 10ms SysTick
+
+   // stock fw bit-bangs 24 bits (8 addr + 16 data) with ~3us per bit
+   static constexpr unsigned int BK4819WriteCycles = 75 * CyclesPerUs;
+   static constexpr unsigned int BK4819ReadCycles = 76 * CyclesPerUs;
+   // Bk4819Spi: GPIO read-modify-writes per bit on top of two half periods,
+   // plus SCN / SDA direction setup per transfer
+   static constexpr unsigned int NativeBitCycles = 14;
+   static constexpr unsigned int NativeTransferCycles = 40;
+   // ST7565 over SPI0, per byte including FIFO polling
+   static constexpr unsigned int LcdByteCycles = 120;
+   static constexpr unsigned int LcdPageCmdBytes = 3;
+   static constexpr unsigned int PollKeyboardCycles = 40 * CyclesPerUs;
+   static constexpr unsigned int FormatStringCycles = 40 * CyclesPerUs;
+   static constexpr unsigned int PrintCharCycles = 5 * CyclesPerUs;
+   // Cortex-M0 integer code, see TM0Int: ALU ops and MULS are single cycle,
+   // a compare is CMP plus a taken branch. The M0 has no divider, / and %
+   // call the stock IntDivide (app 0x128), 32 restoring shift / compare /
+   // subtract rounds of 12..16 cycles plus the call
+   static constexpr unsigned int AluCycles = 1;
+   static constexpr unsigned int CompareCycles = 1 + 2;
+   static constexpr unsigned int DivideCycles = 32 * 14 + 12;
+   // internal flash through the SRAM overlay, typical embedded NOR times
+   static constexpr unsigned int FlashReadCycles = 12;
+   static constexpr unsigned int FlashProgramCycles = 40 * CyclesPerUs;
+   static constexpr unsigned int FlashEraseCycles = 4000 * CyclesPerUs;
+   static constexpr unsigned int FlashSize = 64 * 1024;
+
+   struct TStats
+   {
+      unsigned long long u64Cycles;
+      unsigned int u32RegReads;
+      unsigned int u32RegWrites;
+      unsigned long long u64DelayCycles;
+      unsigned int u32LcdFlushes;
+      unsigned int u32LcdBytes;
+      unsigned int u32KeyboardPolls;
+      unsigned int u32FlashReads;
+      unsigned int u32FlashWords;
+      unsigned int u32FlashErases;
+   };
+
+   struct TCarrier
+   {
+      unsigned int u32Frequency; // 10Hz units, same as BK4819 0x38/0x39
+      unsigned int u32HalfWidth;
+      signed short s16Dbm;
+   };
+
+   class CBK4819Model
+   {
+   public:
+      static constexpr auto RegistersCnt = 0x80;
+      static constexpr signed short NoiseFloorDbm = -125;
+      static constexpr unsigned int RssiSettleUs = 250;
+
+      void Reset(unsigned int u32Frequency);
+      unsigned short Read(unsigned char u8Address);
+      void Write(unsigned char u8Address, unsigned short u16Data);
+
+      template <unsigned char Count>
+      void SetCarriers(const TCarrier (&Carriers)[Count])
+      {
+         pCarriers = Carriers;
+         u8CarriersCnt = Count;
+      }
+
+      unsigned int GetFrequency() const;
+      unsigned short GetRegister(unsigned char u8Address) const
+      {
+         return U16Regs[u8Address & (RegistersCnt - 1)];
+      }
+
+      // fsk modem at 1200 baud. Words written to 0x5F go on air when 0x59
+      // enables tx, 0x5D<15:8> + 1 bytes of them. A frame handed to
+      // StartRxFrame comes out of the 0x5F rx fifo at air speed while the
+      // modem (0x58 bit 0) and rx (0x59 bit 12) stay on, zeros after its
+      // end up to the 0x5D length, then RxDone
+      static constexpr unsigned int FskByteCycles = CpuClockHz / 1200 * 8;
+      static constexpr unsigned char FskPreambleBytes = 7 + 4; // and sync word
+      static constexpr unsigned short FskMaxAirLen = 256;
+
+      const unsigned char *GetTxFrame() const { return U8TxAir; }
+      unsigned short GetTxFrameLen() const { return u16TxAirLen; }
+      void StartRxFrame(const unsigned char *p8Air, unsigned short u16Len);
+
+   private:
+      signed short GetTargetDbm() const;
+      unsigned short GetRssiReg();
+      unsigned short GetFskLen() const { return (U16Regs[0x5D] >> 8) + 1; }
+      unsigned short GetRxDelivered() const;
+      unsigned char GetRxAirByte(unsigned short u16Idx) const
+      {
+         return u16Idx < u16RxAirLen ? p8RxAir[u16Idx] : 0;
+      }
+      unsigned short GetFskIrq() const;
+
+      unsigned short U16Regs[RegistersCnt];
+      const TCarrier *pCarriers;
+      unsigned char u8CarriersCnt;
+      unsigned long long u64SettleStart;
+      unsigned int u32Lfsr;
+
+      unsigned short U16TxFifo[FskMaxAirLen / 2];
+      unsigned char u8TxFifoLen;
+      unsigned char U8TxAir[FskMaxAirLen];
+      unsigned short u16TxAirLen;
+      unsigned long long u64TxDone; // 0 when no tx finished flag is pending
+      const unsigned char *p8RxAir;
+      unsigned short u16RxAirLen;
+      unsigned long long u64RxStart;
+      unsigned char u8RxWordsRead;
+      bool bRxActive;
+   };
+
+   extern CBK4819Model BK4819;
+
+   void Init(unsigned int u32Frequency = 0);
+   TStats &GetStats();
+   void ResetStats();
+   void Charge(unsigned long long u64Cycles);
+
+   // idles (stock fw main loop) until the next SysTick, returns idle cycles
+   unsigned long long WaitForNextTick();
+
+   // raw key code as returned by PollKeyboard, 0xFF means released
+   void SetKey(unsigned char u8Key);
+
+   // true when the simulated ST7565 shows what is in gDisplayBuffer
+   bool IsPanelInSync();
+
+   // dumps gDisplayBuffer as ascii art, for eyeballing renders
+   void PrintFramebuffer();
+
+   // the whole chip, bootloader included, Init erases it. Programs and
+   // erases after u32Operations more of them get lost as on a power cut,
+   // until the next call
+   const unsigned char *GetFlash();
+   unsigned int GetFlashErases(unsigned int u32Address);
+   void CutFlashPowerAfter(unsigned int u32Operations);
+
+   inline double CyclesToMs(unsigned long long u64Cycles)
+   {
+      return (double)u64Cycles / (CpuClockHz / 1000);
+   }
+}
@@ -0,0 +1,278 @@
+#include "sim.hpp"
+#include "radio.hpp"
+#include "spectrum.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// runs the spectrum_fagci mod against the simulated BK4819 tick by tick and
+// prints time and register traffic of every frame (up to the next lcd flush
+// or completed sweep, a held trace may have nothing to flush, at most
+// ListenTicks ticks for a steady open squelch): wall time,
+// time spent inside the handler and the longest tick. Fails when the panel
+// does not show the framebuffer at the end, when a sweep of the default
+// wide mode ends with the BK4819 left in narrow bandwidth (0x43<14:12>) or
+// when a tick with the squelch open runs past the tick budget. --listen adds
+// a carrier above the trigger level and the longest narrow dwell
+// usage: spectrum_sim [frames] [--adaptive] [--hunt] [--scan-list] [--priority] [--waterfall]
+//                     [--listen] [--trace 0..5] [--dump]
+
+Radio::CBK4819 RadioDriver;
+CSpectrum<RadioDriver> Spectrum;
+
+static constexpr auto CenterFrequency = 434_MHz;
+// all below the trigger level set in main, so frames measure the sweep
+static const Sim::TCarrier Carriers[] = {
+    {433_MHz + 325_KHz, 6250_Hz, -112},
+    {434_MHz + 100_KHz, 6250_Hz, -118},
+    {434_MHz + 550_KHz, 12500_Hz, -108},
+    {446_MHz + 56250_Hz, 3125_Hz, -110}, // PMR446 ch 5, for the scan list
+};
+
+static const Sim::TCarrier ListenCarriers[] = {
+    {433_MHz + 325_KHz, 6250_Hz, -112},
+    {434_MHz + 100_KHz, 6250_Hz, -118},
+    {434_MHz + 50_KHz, 6250_Hz, -70},
+};
+
+static constexpr auto TriggerLevelTaps = 60;
+static constexpr unsigned short WideBw = 0b111 << 12;
+static constexpr auto MaxDelayTaps = 72;  // 1, scanDelay 800 -> 8000us
+static constexpr auto NarrowModeTaps = 2; // 9, mode 5 -> 3
+
+static void TapKey(unsigned char u8Key)
+{
+   Sim::SetKey(u8Key);
+   Spectrum.Handle();
+   Sim::WaitForNextTick();
+   Sim::SetKey(0xFF);
+   Spectrum.Handle();
+   Sim::WaitForNextTick();
+}
+
+// held past the repeat delay, one repeat
+static void HoldKey(unsigned char u8Key)
+{
+   Sim::SetKey(u8Key);
+   for (unsigned char i = 0; i <= Spectrum.KeyRepeatDelayTicks; i++)
+   {
+      Spectrum.Handle();
+      Sim::WaitForNextTick();
+   }
+   Sim::SetKey(0xFF);
+   Spectrum.Handle();
+   Sim::WaitForNextTick();
+}
+
+// spread of the noise bins of the trace, the ones within 5dB of the lowest
+static double TraceNoiseSd()
+{
+   unsigned char u8Min = 255;
+   for (auto const u8Rssi : Spectrum.rssiHistory)
+   {
+      if (u8Rssi && u8Rssi < u8Min)
+      {
+         u8Min = u8Rssi;
+      }
+   }
+
+   double f64Sum = 0, f64Sum2 = 0;
+   unsigned int u32Count = 0;
+   for (auto const u8Rssi : Spectrum.rssiHistory)
+   {
+      if (u8Rssi && u8Rssi <= u8Min + 10)
+      {
+         f64Sum += u8Rssi / 2.0;
+         f64Sum2 += u8Rssi * u8Rssi / 4.0;
+         u32Count++;
+      }
+   }
+
+   if (!u32Count)
+   {
+      return 0;
+   }
+
+   auto const f64Mean = f64Sum / u32Count;
+   return sqrt(f64Sum2 / u32Count - f64Mean * f64Mean);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned int u32Frames = argc > 1 ? atoi(argv[1]) : 20;
+   bool bAdaptive = false, bHunt = false, bScanList = false, bPriority = false;
+   bool bWaterfall = false, bListen = false, bDump = false;
+   unsigned int u32Trace = 0;
+   for (int i = 2; i < argc; i++)
+   {
+      bAdaptive |= !strcmp(argv[i], "--adaptive");
+      bHunt |= !strcmp(argv[i], "--hunt");
+      bScanList |= !strcmp(argv[i], "--scan-list");
+      bPriority |= !strcmp(argv[i], "--priority");
+      bWaterfall |= !strcmp(argv[i], "--waterfall");
+      bListen |= !strcmp(argv[i], "--listen");
+      bDump |= !strcmp(argv[i], "--dump");
+      if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      {
+         u32Trace = atoi(argv[++i]);
+      }
+   }
+
+   Sim::Init(CenterFrequency);
+   if (bListen)
+   {
+      Sim::BK4819.SetCarriers(ListenCarriers);
+   }
+   else
+   {
+      Sim::BK4819.SetCarriers(Carriers);
+   }
+
+   GPIOC->DATA |= GPIO_PIN_3; // flashlight button starts the mod
+   for (unsigned char i = 0; i < TriggerLevelTaps; i++)
+   {
+      TapKey(Keys::ASTERISK);
+   }
+
+   if (bAdaptive)
+   {
+      TapKey(Keys::NUM4);
+   }
+
+   if (bHunt)
+   {
+      TapKey(Keys::NUM6);
+   }
+
+   if (bScanList)
+   {
+      TapKey(Keys::FN1);
+   }
+
+   if (bPriority)
+   {
+      TapKey(Keys::FN2);
+   }
+
+   if (bWaterfall)
+   {
+      TapKey(Keys::MENU);
+   }
+
+   if (bListen)
+   {
+      for (unsigned char i = 0; i < MaxDelayTaps; i++)
+      {
+         TapKey(Keys::NUM1);
+      }
+      for (unsigned char i = 0; i < NarrowModeTaps; i++)
+      {
+         TapKey(Keys::NUM9);
+      }
+   }
+
+   for (unsigned int i = 0; i < u32Trace; i++)
+   {
+      HoldKey(Keys::NUM5);
+   }
+
+   printf("frame   time[ms]  busy[ms]  max tick[ms]  reads  writes  lcd[B]  polls\n");
+   Sim::TStats Total = {};
+   unsigned long long u64TotalBusy = 0;
+   unsigned long long u64MaxTick = 0;
+   unsigned long long u64MaxOpenTick = 0;
+   unsigned int u32SquelchOpens = 0;
+   unsigned int u32NarrowAfterSweep = 0;
+   bool bOpen = false;
+   for (unsigned int i = 0; i < u32Frames; i++)
+   {
+      Sim::ResetStats();
+      auto const u64Start = Sim::GetStats().u64Cycles;
+      unsigned long long u64Busy = 0, u64FrameMaxTick = 0;
+      auto const &Stats = Sim::GetStats();
+      auto const u8Sweeps = Spectrum.sweeps;
+      unsigned char u8Ticks = 0;
+      while (!Stats.u32LcdFlushes && Spectrum.sweeps == u8Sweeps &&
+             u8Ticks++ < Spectrum.ListenTicks)
+      {
+         auto const u64TickStart = Stats.u64Cycles;
+         Spectrum.Handle();
+         auto const u64Tick = Stats.u64Cycles - u64TickStart;
+         u64Busy += u64Tick;
+         if (u64Tick > u64FrameMaxTick)
+         {
+            u64FrameMaxTick = u64Tick;
+         }
+         if (bOpen && u64Tick > u64MaxOpenTick)
+         {
+            u64MaxOpenTick = u64Tick;
+         }
+         Sim::WaitForNextTick();
+
+         // the scan list sets the bandwidth per range, --listen is narrow
+         if (!bScanList && !bListen && Spectrum.sweeps != u8Sweeps &&
+             (Sim::BK4819.GetRegister(0x43) & WideBw) != WideBw)
+         {
+            u32NarrowAfterSweep++;
+         }
+
+         // squelch state is mirrored on PC4
+         bool const bNowOpen = GPIOC->DATA & GPIO_PIN_4;
+         u32SquelchOpens += bNowOpen && !bOpen;
+         bOpen = bNowOpen;
+      }
+
+      auto const u64Frame = Stats.u64Cycles - u64Start;
+      printf("%5u %10.2f %9.2f %13.2f %6u %7u %7u %6u\n", i,
+             Sim::CyclesToMs(u64Frame), Sim::CyclesToMs(u64Busy),
+             Sim::CyclesToMs(u64FrameMaxTick), Stats.u32RegReads,
+             Stats.u32RegWrites, Stats.u32LcdBytes, Stats.u32KeyboardPolls);
+
+      Total.u64Cycles += u64Frame;
+      u64TotalBusy += u64Busy;
+      if (u64FrameMaxTick > u64MaxTick)
+      {
+         u64MaxTick = u64FrameMaxTick;
+      }
+      Total.u32RegReads += Stats.u32RegReads;
+      Total.u32RegWrites += Stats.u32RegWrites;
+      Total.u32LcdBytes += Stats.u32LcdBytes;
+   }
+
+   if (!u32Frames)
+   {
+      return 0;
+   }
+
+   printf("avg   %10.2f %9.2f %13.2f %6u %7u %7u\n",
+          Sim::CyclesToMs(Total.u64Cycles) / u32Frames,
+          Sim::CyclesToMs(u64TotalBusy) / u32Frames,
+          Sim::CyclesToMs(u64MaxTick),
+          Total.u32RegReads / u32Frames, Total.u32RegWrites / u32Frames,
+          Total.u32LcdBytes / u32Frames);
+   printf("frames/s %.2f\n", 1000.0 * u32Frames / Sim::CyclesToMs(Total.u64Cycles));
+   printf("peak %u.%05u MHz\n", Spectrum.peakF / 100000, Spectrum.peakF % 100000);
+   printf("squelch opens %u\n", u32SquelchOpens);
+   bool const bOpenInBudget = u64MaxOpenTick <= Spectrum.TickBudgetCycles;
+   printf("max open tick %.2f ms%s\n", Sim::CyclesToMs(u64MaxOpenTick),
+          bOpenInBudget ? "" : " OVER BUDGET");
+   printf("trace noise sd %.2f dB\n", TraceNoiseSd());
+   bool const bInSync = Sim::IsPanelInSync();
+   printf("panel %s\n", bInSync ? "in sync" : "OUT OF SYNC");
+   if (!bScanList && !bListen)
+   {
+      printf("narrow after sweep %u\n", u32NarrowAfterSweep);
+   }
+   if (bPriority)
+   {
+      printf("priority max revisit %u ms\n", Spectrum.priorityMaxRoundMs);
+   }
+
+   if (bDump)
+   {
+      Sim::PrintFramebuffer();
+   }
+
+   return !bInSync || u32NarrowAfterSweep || !bOpenInBudget;
+}
@@ -0,0 +1,99 @@
+#include "sim.hpp"
+#include "system.hpp"
+#include "uv_k5_display.hpp"
+#include "radio.hpp"
+#include "rssi_sbar.hpp"
+#include "manager.hpp"
+#include "heater.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+// runs the rssi_sbar_hot view set through CViewManager and prints
+// the average cost of one SysTick. Fails when the panel does not show
+// the framebuffer at the end
+// usage: views_sim [ticks]
+
+TUV_K5Display DisplayBuff(gDisplayBuffer);
+const TUV_K5SmallNumbers FontSmallNr(gSmallDigs);
+CDisplay Display(DisplayBuff);
+
+TUV_K5Display StatusBarBuff(gStatusBarData);
+CDisplay DisplayStatusBar(StatusBarBuff);
+
+Radio::CBK4819 RadioDriver;
+
+CRssiSbar<
+    DisplayBuff,
+    Display,
+    DisplayStatusBar,
+    FontSmallNr,
+    RadioDriver>
+    RssiSbar;
+
+CHeater Heater;
+CAmRx AmRx;
+
+static IMenuElement *const MainMenuElements[] = {&Heater, &AmRx, &RssiSbar};
+
+CMenu Menu(MainMenuElements);
+
+static IView *const Views[] = {&RssiSbar, &Menu};
+CViewManager<
+    8, 1, sizeof(Views) / sizeof(*Views), &DisplayBuff>
+    Manager(Views);
+
+static const Sim::TCarrier Carriers[] = {
+    {434_MHz, 6250_Hz, -80},
+};
+
+int main(int argc, char **argv)
+{
+   unsigned int u32Ticks = argc > 1 ? atoi(argv[1]) : 2000;
+
+   Sim::Init(434_MHz);
+   Sim::BK4819.SetCarriers(Carriers);
+   Sim::BK4819.Write(0x0C, 0b10); // squelch open, s-meter visible
+
+   Sim::TStats Total = {};
+   unsigned int u32MaxTick = 0;
+   for (unsigned int i = 0; i < u32Ticks; i++)
+   {
+      if (i == u32Ticks / 2)
+      {
+         GPIOC->DATA |= GPIO_PIN_3; // open menu
+      }
+
+      Sim::ResetStats();
+      auto const u64Start = Sim::GetStats().u64Cycles;
+      Manager.Handle();
+
+      auto const &Stats = Sim::GetStats();
+      auto const u64Tick = Stats.u64Cycles - u64Start;
+      if (u64Tick > u32MaxTick)
+      {
+         u32MaxTick = u64Tick;
+      }
+
+      Total.u64Cycles += u64Tick;
+      Total.u32RegReads += Stats.u32RegReads;
+      Total.u32RegWrites += Stats.u32RegWrites;
+      Total.u32LcdBytes += Stats.u32LcdBytes;
+      Total.u32LcdFlushes += Stats.u32LcdFlushes;
+   }
+
+   if (!u32Ticks)
+   {
+      return 0;
+   }
+
+   printf("ticks %u\n", u32Ticks);
+   printf("avg tick   %8.3f ms\n", Sim::CyclesToMs(Total.u64Cycles) / u32Ticks);
+   printf("max tick   %8.3f ms\n", Sim::CyclesToMs(u32MaxTick));
+   printf("reg reads  %8.2f /tick\n", (double)Total.u32RegReads / u32Ticks);
+   printf("reg writes %8.2f /tick\n", (double)Total.u32RegWrites / u32Ticks);
+   printf("lcd        %8.2f B/tick, %u flushes\n",
+          (double)Total.u32LcdBytes / u32Ticks, Total.u32LcdFlushes);
+   bool const bInSync = Sim::IsPanelInSync();
+   printf("panel      %s\n", bInSync ? "in sync" : "OUT OF SYNC");
+   return !bInSync;
+}
@@ -35,7 +35,7 @@ CAmTx<
 
 static IView * const Views[] = {&AmTx};
 CViewManager<
-    8, 1, sizeof(Views) / sizeof(*Views)>
+    8, 1, sizeof(Views) / sizeof(*Views), &DisplayBuff>
     Manager(Views);
 
 int main()
@@ -2,13 +2,33 @@
 #include "uv_k5_display.hpp"
 #include "keyboard.hpp"
 #include "radio.hpp"
+#include "message_log.hpp"
+#include "text_codec.hpp"
 #include "t9.hpp"
+#include "number_format.hpp"
 
+// one Packet per message (Packet::eKind::CodedText), no acks or retries.
+// The text is TextCodec coded over itself in S8TxBuff for the send and
+// decoded back after it, received text is decoded over its frame.
+// CArq<12> keeps ~168 bytes of fragment state and message copies, more
+// than the 300 byte RAM window of memory.ld has left next to this class
+// and the radio driver, so reliable delivery is the libs/views messenger's,
+// built as src/messenger_arq with a 768 byte window
 template <Radio::CBK4819 &RadioDriver>
 class CMessenger
 {
 public:
    static constexpr auto MaxCharsInLine = 128 / 8;
+   static constexpr unsigned char MaxTextLen = 49;
+   // Fec coded packets, twice the air time but bit errors get repaired.
+   // Both ends have to agree
+   static constexpr bool UseFec = true;
+   // top two sectors of the app window, received messages stay there
+   // over power cycles. Only with FLASH_WRITE_ENABLED, which also needs
+   // the FLASH region of memory.ld cut to 59K, see README
+   static constexpr bool UseHistory = FLASH_WRITE_ENABLED;
+   static constexpr unsigned int HistoryAddress = 0xEC00;
+   static constexpr unsigned char HistorySectors = 2;
    friend class CKeyboard<CMessenger>;
 
    enum class eState : unsigned char
@@ -28,10 +48,30 @@ public:
          bDisplayCleared(true),
          bEnabled(0),
          State(eState::InitRx),
-         u8RxDoneLabelCnt(0xFF){};
+         u8RxDoneLabelCnt(0xFF),
+         u8TxSeq(0),
+         u8HistoryAge(0),
+         bHistoryPending(false)
+   {
+      if (UseHistory)
+      {
+         History.Init();
+         History.Read(0, S8RxBuff, sizeof(S8RxBuff));
+      }
+   }
 
    void Handle()
    {
+      RadioDriver.HandleRx();
+      // not from the rx callback: erasing the next sector keeps IRQs off
+      // for ~4 ms of the 10 ms tick. Rx is armed again further down, so
+      // no fsk byte is missed meanwhile, the keyboard and tick are late
+      if (bHistoryPending)
+      {
+         bHistoryPending = false;
+         History.Append(S8RxBuff, strnlen(S8RxBuff, sizeof(S8RxBuff)));
+      }
+
       if (!(GPIOC->DATA & 0b1))
       {
          return;
@@ -53,24 +93,43 @@ public:
       {
       }
 
-      char C8PrintBuff[30];
+      char C8PrintBuff[MaxCharsInLine + 1];
       bDisplayCleared = false;
       ClearDrawings();
 
-      Display.DrawHLine(3, 3 + 10, 1 * 8 + T9.GetIdx() * 8 + 2);
-      // print tx data
-      FormatString(C8PrintBuff, ">%s", T9.C8WorkingBuff);
+      // print tx data, the end of it when it's longer than the line
+      auto const u8Len = T9.GetIdx();
+      auto const u8Start = u8Len < MaxCharsInLine ? 0 : u8Len - (MaxCharsInLine - 1);
+      Display.DrawHLine(3, 3 + 10, 1 * 8 + (u8Len - u8Start) * 8 + 2);
+      C8PrintBuff[0] = '>';
+      memcpy(C8PrintBuff + 1, S8TxBuff + u8Start, u8Len - u8Start);
+      C8PrintBuff[1 + u8Len - u8Start] = '\0';
       PrintTextOnScreen(C8PrintBuff, 0, 128, 0, 8, 0);
 
-      // print rx data
-      char C8Temp = S8RxBuff[MaxCharsInLine];
-      S8RxBuff[MaxCharsInLine] = '\0';
-      PrintTextOnScreen(S8RxBuff, 1, 128, 3, 8, 0);
-      S8RxBuff[MaxCharsInLine] = C8Temp;
-      PrintTextOnScreen(S8RxBuff + MaxCharsInLine, 1, 128, 5, 8, 0);
+      // print rx data, older messages come straight from flash and S8RxBuff
+      // is left to the radio
+      char C8History[2 * MaxCharsInLine + 1];
+      char *pRx = S8RxBuff;
+      if (UseHistory && u8HistoryAge)
+      {
+         History.Read(u8HistoryAge, C8History, sizeof(C8History));
+         pRx = C8History;
+      }
+
+      char C8Temp = pRx[MaxCharsInLine];
+      pRx[MaxCharsInLine] = '\0';
+      PrintTextOnScreen(pRx, 1, 128, 3, 8, 0);
+      pRx[MaxCharsInLine] = C8Temp;
+      PrintTextOnScreen(pRx + MaxCharsInLine, 1, 128, 5, 8, 0);
 
       Display.DrawRectangle(0, (8 * 4) - 6, 127, 24 + 6, false);
 
+      if (UseHistory && u8HistoryAge)
+      {
+         NumberFormat::Unsigned(NumberFormat::String(C8PrintBuff, "  history -"), u8HistoryAge);
+         PrintTextOnScreen(C8PrintBuff, 0, 128, 2, 8, 1);
+      }
+
       if (u8RxDoneLabelCnt < 100)
       {
          u8RxDoneLabelCnt++;
@@ -91,7 +150,9 @@ public:
          if (u8TxDelay++ >= 1)
          {
             u8TxDelay = 0;
-            RadioDriver.SendSyncAirCopyMode72((unsigned char *)S8TxBuff);
+            auto const u8Coded = TextCodec::EncodeInPlace(S8TxBuff, T9.GetIdx(), sizeof(S8TxBuff));
+            RadioDriver.SendSyncPacket(Packet::eKind::CodedText, u8TxSeq++, (unsigned char *)S8TxBuff, u8Coded, UseFec);
+            TextCodec::DecodeInPlace(S8TxBuff, sizeof(S8TxBuff), 0, u8Coded);
             State = eState::InitRx;
          }
 
@@ -105,10 +166,21 @@ public:
       FlushFramebufferToScreen();
    }
 
+   // u8DataLen is the payload length, S8RxBuff holds the whole frame
    void RxDoneHandler(unsigned char u8DataLen, bool bCrcOk)
    {
-      bEnabled = true;
       State = eState::InitRx;
+      if (!bCrcOk)
+      {
+         memset(S8RxBuff, 0, sizeof(S8RxBuff));
+         return;
+      }
+
+      auto const u8TextLen = TextCodec::DecodeInPlace(S8RxBuff, sizeof(S8RxBuff), Packet::HeaderSize, u8DataLen);
+      memset(S8RxBuff + u8TextLen, 0, sizeof(S8RxBuff) - u8TextLen);
+      bHistoryPending = UseHistory;
+      u8HistoryAge = 0;
+      bEnabled = true;
       u8RxDoneLabelCnt = 0;
    }
 
@@ -134,7 +206,7 @@ private:
 
    void InitRxHandler()
    {
-      RadioDriver.RecieveAsyncAirCopyMode((unsigned char *)S8RxBuff, sizeof(S8RxBuff), Radio::CallbackRxDoneType(this, &CMessenger::RxDoneHandler));
+      RadioDriver.RecieveAsyncPacket(RxRing, (unsigned char *)S8RxBuff, sizeof(S8RxBuff), Radio::CallbackRxDoneType(this, &CMessenger::RxDoneHandler), Packet::eKind::CodedText, UseFec);
       State = eState::WaitForRx;
    }
 
@@ -155,25 +227,57 @@ private:
          return;
       }
 
+      // up goes back in the history, down towards the newest
+      if (UseHistory && (u8Button == 11 || u8Button == 12))
+      {
+         char C8Probe[1];
+         if (u8Button == 12 && u8HistoryAge)
+         {
+            u8HistoryAge--;
+         }
+         else if (u8Button == 11 && History.Read(u8HistoryAge + 1, C8Probe, sizeof(C8Probe)))
+         {
+            u8HistoryAge++;
+         }
+
+         return;
+      }
+
       if (u8Button == 13 && !T9.GetIdx())
       {
          bEnabled = false;
          return;
       }
 
+      // T9 writes a terminator behind the last char, the byte the coded
+      // text needs for its header
+      if (T9.GetIdx() >= sizeof(S8TxBuff) - TextCodec::HeaderSize && u8Button != 13)
+      {
+         return;
+      }
+
       T9.ProcessButton(u8Button);
    }
 
-   char S8TxBuff[50];
+   // T9 keeps its terminator in the byte the TextCodec header takes
+   char S8TxBuff[MaxTextLen + TextCodec::HeaderSize];
    char S8RxBuff[72];
+   static_assert(TextCodec::HeaderSize >= 1, "T9 needs a byte for its terminator");
+   static_assert(!UseFec || Fec::GetMaxFrameLen(sizeof(S8RxBuff)) >= Packet::GetFrameLen(sizeof(S8TxBuff)),
+                 "rx buffer too short for a Fec coded message");
+   Radio::TRxRing RxRing;
    TUV_K5Display DisplayBuff;
    CDisplay<const TUV_K5Display> Display;
    CKeyboard<CMessenger> Keyboard;
    CT9Decoder<sizeof(S8TxBuff)> T9;
+   CMessageLog<HistoryAddress, HistorySectors> History;
 
    bool bDisplayCleared;
    unsigned char u8LastBtnPressed;
    bool bEnabled;
    eState State;
    unsigned char u8RxDoneLabelCnt;
+   unsigned char u8TxSeq;
+   unsigned char u8HistoryAge;
+   bool bHistoryPending;
 };
@@ -9,7 +9,11 @@ TUV_K5Display DisplayBuff(gDisplayBuffer);
 const TUV_K5SmallNumbers FontSmallNr(gSmallDigs);
 CDisplay Display(DisplayBuff);
 
+TUV_K5Display StatusBarBuff(gStatusBarData);
+CDisplay DisplayStatusBar(StatusBarBuff);
+
 Radio::CBK4819 RadioDriver;
+
 CMessenger<
     DisplayBuff,
     Display,
@@ -19,23 +23,25 @@ CMessenger<
 CRssiSbar<
     DisplayBuff,
     Display,
-    FontSmallNr>
+    DisplayStatusBar,
+    FontSmallNr,
+    RadioDriver>
     RssiSbar;
 
-static IView * const Views[] = {&Messenger, &RssiSbar};
+static IView *const Views[] = {&Messenger, &RssiSbar};
 CViewManager<
-    16, 2, sizeof(Views) / sizeof(*Views)>
+    16, 2, sizeof(Views) / sizeof(*Views), &DisplayBuff>
     Manager(Views);
 
 int main()
 {
-   Fw.IRQ_RESET();
+   IRQ_RESET();
    return 0;
 }
 
 extern "C" void Reset_Handler()
 {
-   Fw.IRQ_RESET();
+   IRQ_RESET();
 }
 
 extern "C" void SysTick_Handler()
@@ -50,5 +56,5 @@ extern "C" void SysTick_Handler()
 
    RadioDriver.InterruptHandler();
    Manager.Handle();
-   Fw.IRQ_SYSTICK();
+   IRQ_SYSTICK();
 }
@@ -25,6 +25,7 @@ public:
 
    void Handle()
    {
+      RadioDriver.HandleRx();
       if (!(GPIOC->DATA & 0b1))
       {
          return;
@@ -38,7 +39,7 @@ public:
 
          DelayMs(600);
          //memset(U8Buff, 0, sizeof(U8Buff));
-         RadioDriver.RecieveAsyncAirCopyMode(U8Buff, sizeof(U8Buff), Radio::CallbackRxDoneType(this, &CSpectrum::RxDoneHandler));
+         RadioDriver.RecieveAsyncAirCopyMode(RxRing, U8Buff, sizeof(U8Buff), Radio::CallbackRxDoneType(this, &CSpectrum::RxDoneHandler));
          State = eState::RxPending;
          // while(State == eState::RxPending)
          // {
@@ -141,5 +142,6 @@ private:
    CDisplay<const TUV_K5Display> Display;
    eState State;
    unsigned char U8Buff[72];
+   Radio::TRxRing RxRing;
    unsigned char u8RxCnt;
 };
@@ -42,7 +42,7 @@ static IView *const Views[] =
 };
 
 CViewManager<
-    8, 2, sizeof(Views) / sizeof(*Views)>
+    8, 2, sizeof(Views) / sizeof(*Views), &DisplayBuff>
     Manager(Views);
 
 int main()
@@ -42,7 +42,7 @@ CMenu Menu(MainMenuElements);
 
 static IView * const Views[] = {&RssiSbar, &Menu};
 CViewManager<
-    8, 1, sizeof(Views) / sizeof(*Views)>
+    8, 1, sizeof(Views) / sizeof(*Views), &DisplayBuff>
     Manager(Views);
 
 int main()
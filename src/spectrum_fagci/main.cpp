@@ -6,7 +6,6 @@
 #include "uv_k5_display.hpp"
 #include <string.h>
 
-Hardware::THardware Hw;
 Radio::CBK4819 RadioDriver;
 CSpectrum<RadioDriver> Spectrum;
 
@@ -0,0 +1,61 @@
+#pragma once
+#include "radio.hpp"
+#include "types.hpp"
+
+// ranges swept one after another in scan list mode, drawn side by side with
+// one pixel per bin. Keep them sorted by frequency and at most 128 bins in
+// total. Frequencies in 10Hz units, steps below 25kHz use narrow bandwidth
+struct TScanRange {
+  u32 start;
+  u32 end;
+  u16 step;
+  u16 dwellUs;
+
+  constexpr u8 GetBinsCnt() const { return (end - start) / step; }
+};
+
+static constexpr TScanRange ScanList[] = {
+    {118_MHz, 119_MHz + 600_KHz, 25_KHz, 800},  // airband, tower/approach
+    {156_MHz, 156_MHz + 800_KHz, 25_KHz, 800},  // marine simplex
+    {446_MHz, 446_MHz + 200_KHz, 6250_Hz, 1600}, // PMR446
+};
+
+static constexpr u8 ScanListSize = sizeof(ScanList) / sizeof(*ScanList);
+
+struct TScanListLayout {
+  u8 bin0[ScanListSize + 1]; // first bin of each range, then total
+};
+
+constexpr TScanListLayout GetScanListLayout() {
+  TScanListLayout layout = {};
+  for (u8 i = 0; i < ScanListSize; ++i) {
+    layout.bin0[i + 1] = layout.bin0[i] + ScanList[i].GetBinsCnt();
+  }
+  return layout;
+}
+
+constexpr bool IsScanListSorted() {
+  for (u8 i = 1; i < ScanListSize; ++i) {
+    if (ScanList[i].start < ScanList[i - 1].end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static constexpr auto ScanListLayout = GetScanListLayout();
+
+static_assert(ScanListLayout.bin0[ScanListSize] <= 128,
+              "scan list doesn't fit the 128 pixel plot");
+static_assert(IsScanListSorted(),
+              "scan list ranges must be sorted and not overlap");
+
+// priority channels, visited round robin every PriorityEveryBins bins of
+// the sweep and every PriorityListenTicks while listening
+static constexpr u32 PriorityChannels[] = {
+    156_MHz + 800_KHz, // marine ch16
+    446_MHz + 6250_Hz, // PMR446 ch1
+};
+
+static constexpr u8 PriorityChannelsCnt =
+    sizeof(PriorityChannels) / sizeof(*PriorityChannels);
@@ -1,14 +1,39 @@
 #pragma once
+#include "hardware/systick.hpp"
 #include "keys.hpp"
 #include "radio.hpp"
+#include "scan_list.hpp"
 #include "system.hpp"
 #include "types.hpp"
 #include "uv_k5_display.hpp"
 
-template <Radio::CBK4819 &RadioDriver> class CSpectrum {
+// sweep runs as a state machine across SysTicks: each tick measures bins
+// until TickBudgetUs of the tick is used, a bin whose RSSI hasn't settled
+// by then is left settling and read in the next tick instead of busy-waiting
+template <Radio::CBK4819 &RadioDriver, u16 TickBudgetUs = 8000>
+class CSpectrum {
 public:
   static constexpr auto DrawingEndY = 42;
-  static constexpr auto BarPos = 5 * 128;
+  static constexpr u8 PlotPages = (DrawingEndY >> 3) + 1;
+  static constexpr u8 BarPage = 5; // ticks and the peak arrow
+
+  // waterfall: the bars shrink to the pages above WaterfallPage at 1dB per
+  // pixel, the pages down to BarPage keep one dithered 1bpp row per sweep.
+  // The framebuffer itself is the history, the newest row goes above the
+  // previous one in WaterfallPage and a full page scrolls down by one page
+  static constexpr u8 WaterfallPage = 2;
+  static constexpr u8 WaterfallPlotEndY = (WaterfallPage << 3) - 1;
+  static constexpr u8 WaterfallFloor = 6; // 0.5dB units above rssiMin
+  static constexpr u8 Bayer4x4[4][4] = {
+      {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+  // top row numbers, x of the field and small font digit width
+  static constexpr u8 DelayX = 0;
+  static constexpr u8 DwellX = 20;
+  static constexpr u8 PeakX = 42;
+  static constexpr u8 TraceX = 92;
+  static constexpr u8 SpanX = 105;
+  static constexpr u8 DigitW = TUV_K5SmallNumbers::FixedSizeY;
 
   static constexpr auto ModesCount = 7;
   static constexpr auto LastLowBWModeIndex = 3;
@@ -19,7 +44,63 @@ public:
       1_KHz, 3125_Hz, 6250_Hz, 12500_Hz, 25_KHz, 25_KHz, 25_KHz};
   static constexpr u8 modeXdiv[ModesCount] = {2, 2, 2, 2, 2, 1, 0};
 
+  // peak hunt: wide modes refine the PeakHuntK strongest local maxima of
+  // the coarse sweep with RefineStep in narrow bandwidth, so peakF is the
+  // carrier itself instead of the nearest 25kHz bin
+  static constexpr auto PeakHuntMinMode = 5;
+  static constexpr auto PeakHuntK = 3;
+  static constexpr u16 RefineStep = 1_KHz;
+  static constexpr u8 RefinePoints = 25_KHz / RefineStep;
+
+  // blacklisted ranges by absolute frequency, sorted by start, so they
+  // survive zoom and pan; 255 in rssiHistory only marks a skipped bin
+  static constexpr auto BlacklistSize = 6;
+  static constexpr u8 SkippedBin = 255;
+
+  // rssiHistory is the displayed trace, each reading is folded into its
+  // bin as it is measured. Averages are exponential with alpha 1/2, 1/4
+  // or 1/8, steadier bins at the same dwell; 0 marks an empty trace
+  enum TraceMode : u8 {
+    TraceLive,
+    TraceMax,
+    TraceMin,
+    TraceAvg2,
+    TraceAvg4,
+    TraceAvg8,
+    TraceModesCount
+  };
+
+  // priority mode: worst case revisit of a priority channel is
+  // PriorityChannelsCnt slots of PriorityEveryBins bins while scanning,
+  // or of PriorityListenTicks while listening
+  static constexpr u8 PriorityEveryBins = 16;
+  static constexpr u8 PriorityListenTicks = 10;
+
+  // squelch: a peak above the open level is retuned to muted and has to
+  // hold for AttackTicks before audio opens, open audio closes after
+  // HangTicks below the close level. The open level never goes below
+  // the noise floor + MinOpenSnr, levels in 0.5dB units
+  enum SquelchState : u8 { SqClosed, SqAttack, SqOpen, SqHang };
+  static constexpr u8 AttackTicks = 3;
+  static constexpr u8 HangTicks = 50;
+  static constexpr u8 MinOpenSnr = 12;
+  static constexpr u8 CloseHysteresis = 6;
+
+  static constexpr u32 TickBudgetCycles = TickBudgetUs * SysTick::CyclesPerUs;
+  static constexpr u8 ListenTicks = 100;
+  static constexpr u8 KeyRepeatDelayTicks = 40;
+  static constexpr u8 KeyRepeatPeriodTicks = 8;
+
+  // adaptive dwell: 0x67 is sampled every AdaptiveSampleUs and the bin is
+  // done once two samples agree, unless it is close to the trigger level or
+  // changed since the previous sweep, those get the full scanDelay
+  static constexpr u16 AdaptiveSampleUs = 100;
+  static constexpr u8 AdaptiveTolerance = 4;    // 0.5dB units
+  static constexpr u8 AdaptiveTriggerGuard = 12; // 0.5dB units
+  static constexpr u8 DwellSumShift = 6;        // dwellSum in 64us units
+
   u8 rssiHistory[128] = {};
+  u8 rssiRaw[128] = {}; // last reading per bin, the trace may be a hold
   u32 fMeasure;
 
   u8 peakT = 0;
@@ -28,103 +109,325 @@ public:
   u32 peakF = 0;
   u8 rssiMin = 255;
   u8 btnCounter = 0;
+  u16 priorityMaxRoundMs = 0; // longest full round over the priority list
+  u8 sweeps = 0;              // completed sweeps, wraps
 
   CSpectrum()
-      : DisplayBuff(gDisplayBuffer), Display(DisplayBuff),
-        FontSmallNr(gSmallDigs), scanDelay(800), mode(5), rssiTriggerLevel(50) {
+      : Display(DisplayBuff), scanDelay(800), mode(5), rssiTriggerLevel(50) {
     Display.SetFont(&FontSmallNr);
     frequencyChangeStep = modeHalfSpectrumBW[mode];
   };
 
-  void Scan() {
-    u8 rssi = 0, rssiMax = 0;
-    u8 iPeak = 0;
-    u32 fPeak = currentFreq;
+  // returns true when the sweep is complete
+  bool Scan() {
+    while (SysTick::GetTickCycles() < TickBudgetCycles) {
+      if (!scanSettling) {
+        if (!NextBin()) {
+          OnScanDone();
+          return true;
+        }
+        RadioDriver.SetFrequencyFast(fMeasure);
+        ResetRSSI();
+        settleStart = Now();
+        scanSettling = true;
+        scanSamples = 0;
+        scanPrevRssi = 0;
+      }
 
-    fMeasure = GetFStart();
+      i32 dwell = GetDwellCycles();
+      if (adaptiveDwell) {
+        i32 sampleAt = ++scanSamples * AdaptiveSampleUs * SysTick::CyclesPerUs;
+        if (sampleAt < dwell) {
+          dwell = sampleAt;
+        }
+      }
 
-    // RadioDriver.ToggleAFDAC(false);
-    MuteAF();
+      i32 left = dwell - (i32)(Now() - settleStart);
+      if (left > 0) {
+        if (SysTick::GetTickCycles() + left > TickBudgetCycles) {
+          scanSamples -= adaptiveDwell;
+          return false; // keeps settling while we are out of the handler
+        }
+        DelayUs((left + SysTick::CyclesPerUs - 1) / SysTick::CyclesPerUs);
+      }
 
-    u16 scanStep = GetScanStep();
-    u8 measurementsCount = GetMeasurementsCount();
+      u8 rssi = ReadRssi();
+      u32 elapsed = Now() - settleStart;
+      if (adaptiveDwell && (i32)elapsed < GetDwellCycles() &&
+          !IsBinStable(rssi)) {
+        continue;
+      }
 
-    for (u8 i = 0;
-         i < measurementsCount && (PollKeyboard() == 255 || resetBlacklist);
-         ++i, fMeasure += scanStep) {
-      if (!resetBlacklist && rssiHistory[i] == 255) {
+      scanSettling = false;
+      dwellSum += elapsed / (SysTick::CyclesPerUs << DwellSumShift);
+      ++dwellBins;
+      if (scanPriority) {
+        scanPriority = false;
+        if (OnPrioritySample(rssi)) {
+          return true;
+        }
         continue;
       }
-      RadioDriver.SetFrequency(fMeasure);
-      rssi = rssiHistory[i] = GetRssi();
-      if (rssi > rssiMax) {
-        rssiMax = rssi;
-        fPeak = fMeasure;
-        iPeak = i;
+      if (refineC) {
+        if (rssi > scanRssiMax) {
+          scanRssiMax = rssi;
+          scanFPeak = fMeasure;
+          scanIPeak = refineCandidates[refineC - 1];
+        }
+        ++refineJ;
+        continue;
+      }
+
+      rssiHistory[scanI] = Trace(rssiHistory[scanI], rssi);
+      rssiRaw[scanI] = rssi;
+      if (rssi > scanRssiMax) {
+        scanRssiMax = rssi;
+        scanFPeak = fMeasure;
+        scanIPeak = scanI;
       }
       if (rssi < rssiMin) {
         rssiMin = rssi;
       }
+      if (rssi < scanRssiMin) {
+        scanRssiMin = rssi;
+      }
+      ++scanI;
     }
-    resetBlacklist = false;
-    ++peakT;
 
-    if (rssiMax > peakRssi || peakT >= 16) {
-      peakT = 0;
-      peakRssi = rssiMax;
-      peakF = fPeak;
-      peakI = iPeak;
+    return false;
+  }
+
+  // selects the next bin to measure into fMeasure, false when the sweep
+  // (coarse and refine pass) is complete
+  bool NextBin() {
+    if (priorityMode && ++binsSincePriority > PriorityEveryBins) {
+      binsSincePriority = 0;
+      fMeasure = PriorityChannels[priorityI];
+      scanPriority = true;
+      return true;
     }
+
+    if (!refineC) {
+      for (; scanI < GetMeasurementsCount(); ++scanI) {
+        if (scanListMode && GetRangeOf(scanI) != scanRange) {
+          scanRange = GetRangeOf(scanI);
+          SetBW();
+        }
+        fMeasure = GetBinF(scanI);
+        if (!IsBlacklisted(fMeasure)) {
+          return true;
+        }
+        rssiHistory[scanI] = SkippedBin;
+      }
+
+      if (!peakHunt || scanListMode || mode < PeakHuntMinMode ||
+          !SelectCandidates()) {
+        return false;
+      }
+      refineC = 1;
+      refineJ = 0;
+      scanRssiMax = 0;
+      SetBW();
+    }
+
+    if (refineJ >= RefinePoints) {
+      refineJ = 0;
+      ++refineC;
+    }
+    if (refineC > PeakHuntK || refineCandidates[refineC - 1] == 255) {
+      refineC = 0; // before SetBW, IsNarrow follows it
+      SetBW();
+      return false;
+    }
+
+    fMeasure = GetFStart() + refineCandidates[refineC - 1] * GetScanStep() -
+               (GetScanStep() >> 1) + refineJ * RefineStep;
+    return true;
   }
 
-  void DrawSpectrum() {
-    for (u8 x = 0; x < 128; ++x) {
-      auto v = rssiHistory[x >> modeXdiv[mode]];
-      if (v != 255) {
-        Display.DrawHLine(Rssi2Y(v), DrawingEndY, x);
+  // PeakHuntK strongest local maxima of the coarse sweep, strongest first
+  bool SelectCandidates() {
+    u8 measurementsCount = GetMeasurementsCount();
+    memset(refineCandidates, 255, sizeof(refineCandidates));
+
+    for (u8 i = 0; i < measurementsCount; ++i) {
+      u8 v = rssiHistory[i];
+      if (v == SkippedBin ||
+          (i && rssiHistory[i - 1] != SkippedBin && rssiHistory[i - 1] > v) ||
+          (i + 1 < measurementsCount && rssiHistory[i + 1] != SkippedBin &&
+           rssiHistory[i + 1] >= v)) {
+        continue;
+      }
+
+      for (u8 k = 0; k < PeakHuntK; ++k) {
+        if (refineCandidates[k] == 255 || v > rssiHistory[refineCandidates[k]]) {
+          memmove(refineCandidates + k + 1, refineCandidates + k,
+                  PeakHuntK - 1 - k);
+          refineCandidates[k] = i;
+          break;
+        }
       }
     }
+
+    return refineCandidates[0] != 255;
   }
 
-  void DrawNums() {
-    Display.SetCoursorXY(0, 0);
-    Display.PrintFixedDigitsNumber3(scanDelay, 2, 2, 1);
+  // the framebuffer holds the previous frame: every column of the plot
+  // pages is composed from rssiHistory and only bytes that differ are
+  // written and marked dirty, so a sweep that moved a few bars costs a few
+  // bytes of lcd traffic. Same pixels as drawing the plot over a cleared
+  // screen with the numbers on top
+  void DrawColumns() {
+    u8 endY = GetPlotEndY();
+    u8 levelY = Rssi2Y(GetOpenLevel());
+    i32 arrowX = peakIsPriority ? -8 : peakI << GetXdiv();
+    for (u8 x = 0; x < 128; ++x) {
+      u8 column[PlotPages] = {};
+      u8 v = rssiHistory[x >> GetXdiv()];
+      if (v != SkippedBin) {
+        u8 top = Rssi2Y(v);
+        for (u8 p = top >> 3; p <= endY >> 3; ++p) {
+          column[p] = 0xFF;
+        }
+        column[top >> 3] &= 0xFF << (top & 7);
+        column[endY >> 3] &= 0xFF >> (7 - (endY & 7));
+      }
 
-    Display.SetCoursorXY(105, 0);
-    Display.PrintFixedDigitsNumber3(GetBW(), 3, 3, 2);
+      // dashed open level, 3 on 1 off
+      if ((x & 3) != 3) {
+        column[levelY >> 3] |= 1 << (levelY & 7);
+      }
 
-    Display.SetCoursorXY(42, 0);
-    Display.PrintFixedDigitsNumber3(peakF, 2, 6, 3);
+      if (IsTick(x)) {
+        column[BarPage] |= 0b00111000;
+      }
 
-    Display.SetCoursorXY(0, 48);
-    Display.PrintFixedDigitsNumber3(GetFStart(), 4, 4, 1);
+      u32 d = abs(x - arrowX);
+      if (d <= 2) {
+        column[BarPage] |= (0b01111000 << d) & 0b01111000;
+      }
 
-    Display.SetCoursorXY(98, 48);
-    Display.PrintFixedDigitsNumber3(GetFEnd(), 4, 4, 1);
+      for (u8 p = IsUnderTopNums(x); p < PlotPages; ++p) {
+        if (IsWaterfallPage(p)) {
+          continue;
+        }
+        u8 &b = gDisplayBuffer[p * 128 + x];
+        if (b != column[p]) {
+          b = column[p];
+          DisplayBuff.MarkDirty(p, x, x + 1);
+        }
+      }
+    }
+  }
 
-    Display.SetCoursorXY(52, 48);
-    Display.PrintFixedDigitsNumber3(frequencyChangeStep, 3, 3, 2);
+  // one row per sweep, a bin is lit when it beats the ordered dither
+  // threshold, so the density of a column follows its level over 8dB
+  void AddWaterfallRow() {
+    if (waterfallRow == 8) {
+      memmove(gDisplayBuffer + (WaterfallPage + 1) * 128,
+              gDisplayBuffer + WaterfallPage * 128,
+              (BarPage - WaterfallPage - 1) * 128);
+      memset(gDisplayBuffer + WaterfallPage * 128, 0, 128);
+      for (u8 p = WaterfallPage; p < BarPage; ++p) {
+        DisplayBuff.MarkDirty(p, 0, 128);
+      }
+      waterfallRow = 0;
+    }
+
+    u8 bit = 0x80 >> waterfallRow;
+    u8 const *threshold = Bayer4x4[waterfallRow++ & 3];
+    u8 *row = gDisplayBuffer + WaterfallPage * 128;
+    for (u8 x = 0; x < 128; ++x) {
+      u8 v = rssiHistory[x >> GetXdiv()];
+      if (v != SkippedBin &&
+          v > rssiMin + WaterfallFloor + threshold[x & 3]) {
+        row[x] |= bit;
+        DisplayBuff.MarkDirty(WaterfallPage, x, x + 1);
+      }
+    }
   }
 
-  void DrawRssiTriggerLevel() {
-    u8 y = Rssi2Y(rssiTriggerLevel);
-    for (u8 x = 0; x < 126; x += 4) {
-      Display.DrawLine(x, x + 2, y);
+  void ClearWaterfall() {
+    memset(gDisplayBuffer + WaterfallPage * 128, 0,
+           (BarPage - WaterfallPage) * 128);
+    for (u8 p = WaterfallPage; p < BarPage; ++p) {
+      DisplayBuff.MarkDirty(p, 0, 128);
     }
+    waterfallRow = 0;
   }
 
-  void DrawTicks() {
-    // center
-    gDisplayBuffer[BarPos + 64] = 0b00111000;
+  bool IsWaterfallPage(u8 p) {
+    return waterfallMode && p >= WaterfallPage && p < BarPage;
   }
 
-  void DrawArrow(u8 x) {
-    for (signed i = -2; i <= 2; ++i) {
-      signed v = x + i;
-      if (!(v & 128)) {
-        gDisplayBuffer[BarPos + v] |= (0b01111000 << abs(i)) & 0b01111000;
+  u8 GetPlotEndY() { return waterfallMode ? WaterfallPlotEndY : DrawingEndY; }
+
+  // center, or range boundaries of the scan list
+  bool IsTick(u8 x) {
+    if (!scanListMode) {
+      return x == 64;
+    }
+    for (u8 i = 1; i < ScanListSize; ++i) {
+      if (x == ScanListLayout.bin0[i]) {
+        return true;
       }
     }
+    return false;
+  }
+
+  // page 0 columns the top row numbers draw, glyphs and the decimal point
+  // but not the gap column before the point
+  static constexpr bool IsInNum(u8 x, u8 numX, u8 digits, u8 pointAt) {
+    return x >= numX && x < numX + digits * DigitW + 2 &&
+           x != numX + (digits - pointAt) * DigitW;
+  }
+
+  bool IsUnderTopNums(u8 x) {
+    return IsInNum(x, DelayX, 2, 1) ||
+           (adaptiveDwell && IsInNum(x, DwellX, 2, 1)) ||
+           IsInNum(x, PeakX, 6, 3) ||
+           (traceMode && x >= TraceX && x < TraceX + DigitW) ||
+           IsInNum(x, SpanX, 3, 2);
+  }
+
+  void DrawNums() {
+    Display.SetCoursorXY(DelayX, 0);
+    Display.PrintFixed<2, 2, 1>(scanDelay);
+
+    if (adaptiveDwell) {
+      Display.SetCoursorXY(DwellX, 0);
+      Display.PrintFixed<2, 2, 1>(avgDwellUs);
+    }
+
+    Display.SetCoursorXY(PeakX, 0);
+    Display.PrintFixed<2, 6, 3>(peakF);
+
+    if (traceMode) {
+      Display.SetCoursorXY(TraceX, 0);
+      Display.PrintFixed<0, 1>(traceMode);
+    }
+
+    // scan list shows the range the peak is in
+    u32 fStart = GetFStart(), fEnd = GetFEnd();
+    u32 step = frequencyChangeStep;
+    if (scanListMode) {
+      auto const &range = ScanList[GetRangeOf(peakI)];
+      fStart = range.start;
+      fEnd = range.end;
+      step = range.step;
+    }
+
+    Display.SetCoursorXY(SpanX, 0);
+    Display.PrintFixed<3, 3, 2>(fEnd - fStart);
+
+    Display.SetCoursorXY(0, 48);
+    Display.PrintFixed<4, 4, 1>(fStart);
+
+    Display.SetCoursorXY(98, 48);
+    Display.PrintFixed<4, 4, 1>(fEnd);
+
+    Display.SetCoursorXY(52, 48);
+    Display.PrintFixed<3, 3, 2>(step);
   }
 
   void OnKeyDown(u8 key) {
@@ -143,11 +446,11 @@ public:
       break;
     case Keys::NUM3:
       UpdateBWMul(1);
-      resetBlacklist = true;
+      ResetTrace();
       break;
     case Keys::NUM9:
       UpdateBWMul(-1);
-      resetBlacklist = true;
+      ResetTrace();
       break;
     case Keys::NUM2:
       UpdateFreqChangeStep(100_KHz);
@@ -157,28 +460,73 @@ public:
       break;
     case Keys::UP:
       UpdateCurrentFreq(frequencyChangeStep);
-      resetBlacklist = true;
+      ResetTrace();
       break;
     case Keys::DOWN:
       UpdateCurrentFreq(-frequencyChangeStep);
-      resetBlacklist = true;
+      ResetTrace();
+      break;
+    case Keys::NUM4:
+      adaptiveDwell = !adaptiveDwell;
+      break;
+    case Keys::NUM6:
+      peakHunt = !peakHunt;
       break;
     case Keys::NUM5:
-      ToggleBacklight();
+      // held 5 takes the backlight back and selects the next trace mode
+      if (btnRepeats == 1) {
+        traceMode = traceMode + 1 < TraceModesCount ? (TraceMode)(traceMode + 1)
+                                                    : TraceLive;
+        ResetTrace();
+      }
+      if (btnRepeats <= 1) {
+        ToggleBacklight();
+      }
       break;
     case Keys::NUM0:
-      Blacklist();
+      // key repeat of a held 0 clears the blacklist
+      if (btnRepeats) {
+        blacklistCnt = 0;
+      } else {
+        Blacklist();
+      }
+      break;
+    case Keys::MENU:
+      // was the blacklist clear, now on a held 0. No key is left free,
+      // keep the map in the README when moving one
+      waterfallMode = !waterfallMode;
+      if (waterfallMode) {
+        ClearWaterfall();
+      }
+      break;
+    case Keys::FN2:
+      priorityMode = !priorityMode;
+      priorityMaxRoundMs = 0;
+      priorityRoundStart = Now();
+      break;
+    case Keys::FN1:
+      scanListMode = !scanListMode;
+      scanRange = 0;
+      rssiMin = 255;
+      SetBW();
+      ResetTrace();
       break;
     case Keys::ASTERISK:
       UpdateRssiTriggerLevel(1);
-      DelayMs(90);
       break;
     case Keys::FUNCTION:
       UpdateRssiTriggerLevel(-1);
-      DelayMs(90);
       break;
     }
-    ResetPeak();
+    // repeats come faster than a sweep, a held key restarts it on release
+    if (btnRepeats) {
+      restartOnKeyUp = true;
+    } else {
+      restartOnKeyUp = false;
+      ResetPeak();
+      RestartScan();
+    }
+    redraw = true;
   }
 
   bool HandleUserInput() {
@@ -189,41 +537,45 @@ public:
       return false;
     }
 
-    if (btn != 255) {
-      if (btn == btnPrev && btnCounter < 255) {
-        btnCounter++;
-      }
-      if (btnPrev == 255 || btnCounter > 16) {
-        OnKeyDown(btn);
+    if (btn == 255) {
+      btnCounter = 0;
+      if (restartOnKeyUp) {
+        restartOnKeyUp = false;
+        ResetPeak();
+        RestartScan();
       }
       return true;
     }
 
-    btnCounter = 0;
+    if (btn != btnPrev) {
+      btnCounter = 0;
+      btnRepeats = 0;
+      OnKeyDown(btn);
+    } else if (++btnCounter >= KeyRepeatDelayTicks) {
+      btnCounter -= KeyRepeatPeriodTicks;
+      if (btnRepeats < 255) {
+        ++btnRepeats;
+      }
+      OnKeyDown(btn);
+    }
     return true;
   }
 
   void Render() {
-    DisplayBuff.ClearAll();
-    DrawTicks();
-    DrawArrow(peakI << modeXdiv[mode]);
-    DrawSpectrum();
-    DrawRssiTriggerLevel();
+    DrawColumns();
     DrawNums();
-    FlushFramebufferToScreen();
+    DisplayBuff.FlushDirty();
   }
 
-  void Update() {
-    if (peakRssi >= rssiTriggerLevel) {
-      ToggleGreen(true);
-      GPIOC->DATA |= GPIO_PIN_4;
-      Listen();
-    }
-    if (peakRssi < rssiTriggerLevel) {
-      ToggleGreen(false);
-      GPIOC->DATA &= ~GPIO_PIN_4;
-      Scan();
+  // returns true when there is new data to render
+  bool Update() {
+    if (squelch == SqClosed) {
+      if (peakRssi < GetOpenLevel()) {
+        return Scan();
+      }
+      SetSquelch(SqAttack);
     }
+    return Listen();
   }
 
   void UpdateRssiTriggerLevel(i32 diff) { rssiTriggerLevel += diff; }
@@ -248,12 +600,39 @@ public:
     frequencyChangeStep = clamp(frequencyChangeStep + diff, 100_KHz, 2_MHz);
   }
 
-  void Blacklist() { rssiHistory[peakI] = 255; }
+  // adds the bin of the current peak, ranges are [start, start + width).
+  // A priority peak has no bin, peakI is the one of an older sweep
+  void Blacklist() {
+    if (peakIsPriority) {
+      return;
+    }
+
+    u16 step = GetBinStep(peakI);
+    u32 start = GetBinF(peakI) - (step >> 1);
+    u8 i = 0;
+    while (i < blacklistCnt && blacklistStart[i] < start) {
+      ++i;
+    }
+    if (blacklistCnt == BlacklistSize ||
+        (i < blacklistCnt && blacklistStart[i] == start)) {
+      return;
+    }
+
+    for (u8 j = blacklistCnt; j > i; --j) {
+      blacklistStart[j] = blacklistStart[j - 1];
+      blacklistWidth[j] = blacklistWidth[j - 1];
+    }
+    blacklistStart[i] = start;
+    blacklistWidth[i] = step;
+    ++blacklistCnt;
+  }
 
   void Handle() {
+    tickCycles += SysTick::GetPeriodCycles();
     if (RadioDriver.IsLockedByOrgFw()) {
       return;
     }
+    RadioDriver.InvalidateShadow(); // stock fw runs between ticks
 
     if (!isInitialized && IsFlashLightOn()) {
       TurnOffFlashLight();
@@ -261,71 +640,362 @@ public:
     }
 
     if (isInitialized && HandleUserInput()) {
-      Update();
-      Render();
+      if (Update() || redraw) {
+        redraw = false;
+        Render();
+      }
     }
   }
 
 private:
   void Init() {
     currentFreq = RadioDriver.GetFrequency();
-    oldAFSettings = BK4819Read(0x47);
-    oldBWSettings = BK4819Read(0x43);
+    oldAFSettings = RadioDriver.ReadRegister(0x47);
+    oldBWSettings = RadioDriver.ReadRegister(0x43);
     MuteAF();
     SetBW();
     ResetPeak();
-    resetBlacklist = true;
+    RestartScan();
     ToggleGreen(false);
+    squelch = SqClosed;
+    waterfallRow = 0;
+    DisplayBuff.ClearAll(); // stock fw screen, the rest is redrawn as needed
     isInitialized = true;
   }
 
   void DeInit() {
+    SetSquelch(SqClosed);
     DisplayBuff.ClearAll();
     FlushFramebufferToScreen();
-    RadioDriver.SetFrequency(currentFreq);
-    RestoreOldAFSettings();
-    BK4819Write(0x43, oldBWSettings);
+    Radio::TRegWrite const restore[] = {
+        Radio::Set(0x39, currentFreq >> 16),
+        Radio::Set(0x38, currentFreq & 0xFFFF),
+        Radio::RxRestartSequence[0],
+        Radio::RxRestartSequence[1],
+        Radio::Set(0x47, oldAFSettings),
+        Radio::Set(0x43, oldBWSettings)};
+    RadioDriver.WriteSequence(restore);
     ToggleGreen(true);
     isInitialized = false;
   }
 
-  void ResetPeak() { peakRssi = 0; }
+  void ResetPeak() {
+    peakRssi = 0;
+    SetSquelch(SqClosed);
+  }
+
+  u8 GetOpenLevel() {
+    u8 minLevel = noiseFloor + MinOpenSnr;
+    return rssiTriggerLevel > minLevel ? rssiTriggerLevel : minLevel;
+  }
+
+  u8 GetCloseLevel() { return GetOpenLevel() - CloseHysteresis; }
+
+  // audio, LED and PTT line follow Open/Hang, closing resumes the sweep
+  void SetSquelch(SquelchState state) {
+    bool wasOpen = squelch >= SqOpen;
+    bool open = state >= SqOpen;
+    if (state == SqClosed && squelch != SqClosed) {
+      RestartScan();
+    }
+    squelch = state;
+    squelchT = 0;
+
+    if (open == wasOpen) {
+      return;
+    }
+    ToggleGreen(open);
+    if (open) {
+      GPIOC->DATA |= GPIO_PIN_4;
+      RestoreOldAFSettings();
+    } else {
+      GPIOC->DATA &= ~GPIO_PIN_4;
+      MuteAF();
+    }
+  }
+
+  void RestartScan() {
+    scanI = 0;
+    scanSettling = false;
+    priorityHop = false;
+    blacklistCursor = 0;
+    if (refineC || scanRange) {
+      refineC = 0;
+      scanRange = 0;
+      SetBW();
+    }
+    scanPrevRssi = 0;
+    scanRssiMax = 0;
+    scanRssiMin = 255;
+    dwellSum = 0;
+    dwellBins = 0;
+    scanIPeak = 0;
+    scanFPeak = currentFreq;
+  }
 
-  void SetBW() { BK4819SetChannelBandwidth(mode <= LastLowBWModeIndex); }
-  void MuteAF() { BK4819Write(0x47, 0); }
-  void RestoreOldAFSettings() { BK4819Write(0x47, oldAFSettings); }
+  void OnScanDone() {
+    ++peakT;
+    ++sweeps;
+
+    if (dwellBins) {
+      avgDwellUs = (u32)(dwellSum << DwellSumShift) / dwellBins;
+    }
+
+    if (scanRssiMin != 255) {
+      noiseFloor = noiseFloor ? (noiseFloor * 3 + scanRssiMin) >> 2 : scanRssiMin;
+    }
+
+    if (scanRssiMax > peakRssi || peakT >= 16) {
+      peakT = 0;
+      peakRssi = scanRssiMax;
+      peakF = scanFPeak;
+      peakI = scanIPeak;
+      peakIsPriority = false;
+    }
+    if (waterfallMode) {
+      AddWaterfallRow();
+    }
+    RestartScan();
+  }
+
+  // fMeasure was PriorityChannels[priorityI], a hit takes over the peak
+  // so Listen moves there right away. Same level the squelch opens at,
+  // a priority reading below it would only be dropped in attack
+  bool OnPrioritySample(u8 rssi) {
+    bool hit = rssi >= GetOpenLevel();
+    if (hit) {
+      peakT = 0;
+      peakRssi = rssi;
+      peakF = fMeasure;
+      peakIsPriority = true;
+    }
+
+    if (++priorityI == PriorityChannelsCnt) {
+      priorityI = 0;
+      u32 roundMs = (Now() - priorityRoundStart) / (SysTick::CyclesPerUs * 1000);
+      priorityRoundStart = Now();
+      if (roundMs > priorityMaxRoundMs) {
+        priorityMaxRoundMs = roundMs;
+      }
+    }
+    return hit;
+  }
+
+  // short hop away from the listened channel, muted. Settles across
+  // ticks like a bin of Scan, PriorityHop reads it
+  void StartPriorityHop() {
+    if (PriorityChannels[priorityI] == peakF) {
+      OnPrioritySample(0);
+      return;
+    }
+
+    MuteAF();
+    fMeasure = PriorityChannels[priorityI];
+    RadioDriver.SetFrequencyFast(fMeasure);
+    ResetRSSI();
+    settleStart = Now();
+    priorityHop = true;
+  }
+
+  void PriorityHop() {
+    i32 left = GetDwellCycles() - (i32)(Now() - settleStart);
+    if (left > 0) {
+      if (SysTick::GetTickCycles() + left > TickBudgetCycles) {
+        return;
+      }
+      DelayUs((left + SysTick::CyclesPerUs - 1) / SysTick::CyclesPerUs);
+    }
+
+    priorityHop = false;
+    if (OnPrioritySample(ReadRssi())) {
+      SetSquelch(SqAttack); // already tuned there
+      return;
+    }
+    fMeasure = peakF;
+    RadioDriver.SetFrequency(fMeasure);
+    RestoreOldAFSettings();
+  }
+
+  void SetBW() { BK4819SetChannelBandwidth(IsNarrow()); }
+
+  bool IsNarrow() {
+    if (refineC) {
+      return true;
+    }
+    return scanListMode ? ScanList[scanRange].step < 25_KHz
+                        : mode <= LastLowBWModeIndex;
+  }
+  void MuteAF() { RadioDriver.WriteRegister(0x47, 0); }
+  void RestoreOldAFSettings() { RadioDriver.WriteRegister(0x47, oldAFSettings); }
+
+  // runs every tick while the squelch isn't closed, one 0x67 read per
+  // tick drives the attack and hang timers
+  bool Listen() {
+    if (priorityHop) {
+      PriorityHop();
+      return false;
+    }
 
-  void Listen() {
     if (fMeasure != peakF) {
       fMeasure = peakF;
       RadioDriver.SetFrequency(fMeasure);
-      RestoreOldAFSettings();
       // RadioDriver.ToggleAFDAC(true);
+      RestartScan();
+      if (scanListMode && !peakIsPriority && GetRangeOf(peakI)) {
+        scanRange = GetRangeOf(peakI);
+        SetBW();
+      }
+      SetSquelch(SqAttack);
+      listenT = 0;
+      return false; // let it settle until the next tick
     }
-    for (u8 i = 0; i < 16 && PollKeyboard() == 255; ++i) {
-      DelayMs(64);
+
+    if (squelch >= SqOpen && priorityMode &&
+        ++binsSincePriority >= PriorityListenTicks) {
+      binsSincePriority = 0;
+      StartPriorityHop();
+      return false;
     }
-    peakRssi = rssiHistory[peakI] = GetRssi();
+
+    peakRssi = ReadRssi();
+    switch (squelch) {
+    case SqAttack:
+      if (peakRssi < GetOpenLevel()) {
+        SetSquelch(SqClosed);
+        return true;
+      }
+      if (++squelchT >= AttackTicks) {
+        SetSquelch(SqOpen);
+      }
+      break;
+    case SqOpen:
+      if (peakRssi < GetCloseLevel()) {
+        SetSquelch(SqHang);
+      }
+      break;
+    case SqHang:
+      if (peakRssi >= GetCloseLevel()) {
+        SetSquelch(SqOpen);
+      } else if (++squelchT >= HangTicks) {
+        SetSquelch(SqClosed);
+        return true;
+      }
+      break;
+    default:
+      break;
+    }
+
+    if (++listenT < ListenTicks) {
+      return false;
+    }
+    listenT = 0;
+    if (!peakIsPriority) {
+      rssiHistory[peakI] = Trace(rssiHistory[peakI], peakRssi);
+    }
+    return true;
   }
 
   u16 GetScanStep() { return modeScanStep[mode]; }
-  u32 GetBW() { return modeHalfSpectrumBW[mode] << 1; }
   u32 GetFStart() { return currentFreq - modeHalfSpectrumBW[mode]; }
   u32 GetFEnd() { return currentFreq + modeHalfSpectrumBW[mode]; }
 
-  u8 GetMeasurementsCount() { return 128 >> modeXdiv[mode]; }
+  u8 GetMeasurementsCount() {
+    return scanListMode ? ScanListLayout.bin0[ScanListSize]
+                        : 128 >> modeXdiv[mode];
+  }
+
+  u8 GetXdiv() { return scanListMode ? 0 : modeXdiv[mode]; }
+
+  u8 GetRangeOf(u8 bin) {
+    u8 r = 0;
+    while (r + 1 < ScanListSize && bin >= ScanListLayout.bin0[r + 1]) {
+      ++r;
+    }
+    return r;
+  }
+
+  u16 GetBinStep(u8 bin) {
+    return scanListMode ? ScanList[GetRangeOf(bin)].step : GetScanStep();
+  }
+
+  u32 GetBinF(u8 bin) {
+    if (!scanListMode) {
+      return GetFStart() + bin * GetScanStep();
+    }
+    u8 r = GetRangeOf(bin);
+    return ScanList[r].start + (bin - ScanListLayout.bin0[r]) * ScanList[r].step;
+  }
 
   void ResetRSSI() {
     RadioDriver.ToggleRXDSP(false);
     RadioDriver.ToggleRXDSP(true);
   }
 
-  u8 GetRssi() {
-    ResetRSSI();
+  i32 GetDwellCycles() {
+    if (scanListMode) {
+      return ScanList[scanRange].dwellUs * SysTick::CyclesPerUs;
+    }
+    return (scanDelay << IsNarrow()) * SysTick::CyclesPerUs;
+  }
+
+  bool IsBinStable(u8 rssi) {
+    u8 prev = scanPrevRssi;
+    scanPrevRssi = rssi;
+    // 0 is never a real reading, means no previous sample of this bin
+    return prev && AbsDiff(rssi, prev) <= AdaptiveTolerance &&
+           (refineC || scanPriority ||
+            AbsDiff(rssi, rssiRaw[scanI]) <= AdaptiveTolerance) &&
+           rssi + AdaptiveTriggerGuard < rssiTriggerLevel;
+  }
 
-    DelayUs(scanDelay << (mode <= LastLowBWModeIndex));
-    auto v = BK4819Read(0x67) & 0x1FF;
-    return v < 255 ? v : 255;
+  // coarse bins come in ascending frequency, so the cursor only moves
+  // forward during a sweep and the lookup is amortized O(1)
+  bool IsBlacklisted(u32 f) {
+    while (blacklistCursor < blacklistCnt &&
+           blacklistStart[blacklistCursor] + blacklistWidth[blacklistCursor] <= f) {
+      ++blacklistCursor;
+    }
+    return blacklistCursor < blacklistCnt && blacklistStart[blacklistCursor] <= f;
+  }
+
+  u8 Trace(u8 trace, u8 rssi) {
+    if (!trace || trace == SkippedBin) {
+      return rssi;
+    }
+
+    switch (traceMode) {
+    case TraceMax:
+      return rssi > trace ? rssi : trace;
+    case TraceMin:
+      return rssi < trace ? rssi : trace;
+    case TraceAvg2:
+    case TraceAvg4:
+    case TraceAvg8: {
+      // rounded away from the trace, so it settles on the input
+      u8 shift = traceMode - TraceAvg2 + 1;
+      i32 d = rssi - trace;
+      return trace + ((d + (d > 0 ? (1 << shift) - 1 : 0)) >> shift);
+    }
+    default:
+      return rssi;
+    }
+  }
+
+  // the frequency axis changed, old readings would be folded into
+  // other frequencies
+  void ResetTrace() {
+    memset(rssiHistory, 0, sizeof(rssiHistory));
+    memset(rssiRaw, 0, sizeof(rssiRaw));
+  }
+
+  u8 AbsDiff(u8 a, u8 b) { return a > b ? a - b : b - a; }
+
+  // monotonic core cycles, wraps every ~89s which is fine for differences
+  u32 Now() { return tickCycles + SysTick::GetTickCycles(); }
+
+  u8 ReadRssi() {
+    auto v = RadioDriver.ReadRegister(0x67) & 0x1FF;
+    return v < SkippedBin ? v : SkippedBin - 1;
   }
 
   bool IsFlashLightOn() { return GPIOC->DATA & GPIO_PIN_3; }
@@ -340,16 +1010,17 @@ private:
   void ToggleGreen(bool flag) { BK4819SetGpio(6, flag); }
 
   u8 Rssi2Y(u8 rssi) {
-    return DrawingEndY - clamp(rssi - rssiMin, 0, DrawingEndY);
+    u8 endY = GetPlotEndY();
+    return endY - clamp((rssi - rssiMin) >> waterfallMode, 0, endY);
   }
 
   i32 clamp(i32 v, i32 min, i32 max) {
     return v <= min ? min : (v >= max ? max : v);
   }
 
-  TUV_K5Display DisplayBuff;
+  static inline TUV_K5Display DisplayBuff{gDisplayBuffer}; // + dirty spans
+  static constexpr TUV_K5SmallNumbers FontSmallNr{gSmallDigs};
   CDisplay<const TUV_K5Display> Display;
-  const TUV_K5SmallNumbers FontSmallNr;
 
   u16 scanDelay;
   u8 mode;
@@ -357,11 +1028,59 @@ private:
 
   u8 btn;
   u8 btnPrev;
+  u8 btnRepeats;
+  bool restartOnKeyUp;
   u32 currentFreq;
   u16 oldAFSettings;
   u16 oldBWSettings;
   u32 frequencyChangeStep;
 
   bool isInitialized;
-  bool resetBlacklist;
+  SquelchState squelch;
+  u8 squelchT;
+  u8 noiseFloor;
+  u8 scanRssiMin;
+  bool redraw;
+
+  u32 tickCycles;
+  u32 settleStart;
+  u32 scanFPeak;
+  u8 scanI;
+  u8 scanIPeak;
+  u8 scanRssiMax;
+  bool scanSettling;
+  u8 listenT;
+
+  bool adaptiveDwell;
+  u8 scanSamples;
+  u8 scanPrevRssi;
+  u8 dwellBins;
+  u16 dwellSum;
+  u16 avgDwellUs;
+
+  bool peakHunt;
+  u8 refineC; // 1-based candidate being refined, 0 in the coarse pass
+  u8 refineJ;
+  u8 refineCandidates[PeakHuntK];
+
+  u32 blacklistStart[BlacklistSize];
+  u16 blacklistWidth[BlacklistSize];
+  u8 blacklistCnt;
+  u8 blacklistCursor;
+
+  bool scanListMode;
+  u8 scanRange;
+
+  bool priorityMode;
+  bool scanPriority;
+  bool peakIsPriority;
+  bool priorityHop; // Listen is away on PriorityChannels[priorityI]
+  u8 priorityI;
+  u8 binsSincePriority; // bins while scanning, ticks while listening
+  u32 priorityRoundStart;
+
+  TraceMode traceMode;
+
+  bool waterfallMode;
+  u8 waterfallRow; // rows drawn into WaterfallPage
 };